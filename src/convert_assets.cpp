@@ -0,0 +1,259 @@
+#ifdef COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#else
+#define _CRT_SECURE_NO_DEPRECATE
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+
+#include "./slim/platforms/win32_base.h"
+#include "./slim/core/parallel.h"
+
+// Converts all the assets listed in a manifest, one per line as the converter then its arguments:
+//   <converter> <input file> <output file> [converter options...]
+// e.g. `obj2mesh models/dog.obj assets/dog.mesh scale:2` (lines starting with '#' are comments, and paths
+// with spaces can be quoted). Converters are the obj2mesh/bmp2texture/bmp2image/stb2image executables found
+// next to this one, and each asset converts in its own process, concurrently with the others.
+// An asset's hash covers its input's content, its converter's executable and its options. The hashes of
+// converted assets are kept next to the manifest (in <manifest>.cache), and assets whose output exists
+// and whose hash did not change since are skipped:
+#define ASSET_MAX_TOKENS 16
+#define ASSET_MAX_CONVERTERS 16
+#define ASSET_COMMAND_LINE_SIZE 4096
+#define ASSET_PATH_SIZE 1024
+#define CONVERTER_EXTENSION ".exe"
+
+enum AssetStatus {
+    AssetStatus_Converted,
+    AssetStatus_UpToDate,
+    AssetStatus_Failed
+};
+
+struct Asset {
+    char *tokens[ASSET_MAX_TOKENS]; // The converter, input, output then the options
+    u32 token_count;
+    u32 converter_index;
+    u64 hash;
+    u64 cached_hash;
+    bool cached;
+    AssetStatus status;
+    f64 seconds;
+
+    char* converter() const { return tokens[0]; }
+    char* input() const { return tokens[1]; }
+    char* output() const { return tokens[2]; }
+};
+
+struct Converter {
+    char *name;
+    u64 hash;
+    bool found;
+};
+
+INLINE u64 hashBytes(const void *bytes, u64 size, u64 hash = 14695981039346656037ULL) {
+    const u8 *byte = (const u8*)bytes;
+    for (u64 i = 0; i < size; i++) hash = (hash ^ byte[i]) * 1099511628211ULL;
+    return hash;
+}
+
+bool hashFile(const char *file_path, u64 &hash) {
+    u64 size;
+    void *content = os::mapFileForReading(file_path, &size);
+    if (!content) return os::getFileSizeWithoutOpening(file_path) == 0; // Empty files can not be mapped
+
+    hash = hashBytes(content, size, hash);
+    os::unmapFile(content);
+    return true;
+}
+
+// Splits the line in place into tokens separated by spaces or tabs (or enclosed in double quotes):
+u32 splitLine(char *line, char **tokens) {
+    u32 token_count = 0;
+    char *c = line;
+    while (*c) {
+        while (*c == ' ' || *c == '\t') c++;
+        if (!*c || token_count == ASSET_MAX_TOKENS) break;
+
+        bool quoted = *c == '"';
+        if (quoted) c++;
+        tokens[token_count++] = c;
+        while (*c && (quoted ? *c != '"' : (*c != ' ' && *c != '\t'))) c++;
+        if (*c) *c++ = 0;
+    }
+    return token_count;
+}
+
+// Reads the whole file as a null-terminated string, returning its lines as null-terminated strings:
+char* readLines(const char *file_path, u32 &line_count, char **&lines) {
+    u64 size;
+    void *content = os::mapFileForReading(file_path, &size);
+    char *text = new char[size + 1];
+    if (content) {
+        memcpy(text, content, size);
+        os::unmapFile(content);
+    }
+    text[size] = 0;
+
+    line_count = 1;
+    for (u64 i = 0; i < size; i++) if (text[i] == '\n') line_count++;
+    lines = new char*[line_count];
+    lines[0] = text;
+    line_count = 1;
+    for (char *c = text; *c; c++)
+        if (*c == '\n' || *c == '\r') {
+            if (*c == '\n') lines[line_count++] = c + 1;
+            *c = 0;
+        }
+    return text;
+}
+
+int convertAssets(char *manifest_file_path, char *converters_directory, u32 thread_count, bool force) {
+    if (os::getFileSizeWithoutOpening(manifest_file_path) < 0) {
+        printf("Manifest not found: %s\n", manifest_file_path);
+        return 1;
+    }
+
+    u32 line_count;
+    char **lines;
+    char *manifest = readLines(manifest_file_path, line_count, lines);
+
+    Asset *assets = new Asset[line_count];
+    u32 asset_count = 0;
+    Converter converters[ASSET_MAX_CONVERTERS];
+    u32 converter_count = 0;
+    char path[ASSET_PATH_SIZE];
+    for (u32 l = 0; l < line_count; l++) {
+        Asset &asset = assets[asset_count];
+        asset.token_count = splitLine(lines[l], asset.tokens);
+        if (!asset.token_count || asset.tokens[0][0] == '#') continue;
+        if (asset.token_count < 3) {
+            printf("%s(%lu): Expected a converter, an input and an output\n", manifest_file_path, (unsigned long)(l + 1));
+            return 1;
+        }
+
+        for (asset.converter_index = 0; asset.converter_index < converter_count; asset.converter_index++)
+            if (!strcmp(converters[asset.converter_index].name, asset.converter())) break;
+        if (asset.converter_index == converter_count) {
+            if (converter_count == ASSET_MAX_CONVERTERS) {
+                printf("%s(%lu): Too many converters\n", manifest_file_path, (unsigned long)(l + 1));
+                return 1;
+            }
+            Converter &converter = converters[converter_count++];
+            converter.name = asset.converter();
+            converter.hash = hashBytes(converter.name, strlen(converter.name));
+            snprintf(path, ASSET_PATH_SIZE, "%s%s" CONVERTER_EXTENSION, converters_directory, converter.name);
+            converter.found = hashFile(path, converter.hash);
+            if (!converter.found) printf("Converter not found: %s\n", path);
+        }
+
+        asset.cached = false;
+        asset_count++;
+    }
+
+    // Cache lines are a hash (in hex) then the output it was converted into:
+    char cache_file_path[ASSET_PATH_SIZE];
+    snprintf(cache_file_path, ASSET_PATH_SIZE, "%s.cache", manifest_file_path);
+    u32 cache_line_count;
+    char **cache_lines;
+    char *cache = readLines(cache_file_path, cache_line_count, cache_lines);
+    if (!force)
+        for (u32 l = 0; l < cache_line_count; l++) {
+            char *output = strchr(cache_lines[l], ' ');
+            if (!output) continue;
+
+            u64 hash = strtoull(cache_lines[l], nullptr, 16);
+            for (u32 a = 0; a < asset_count; a++)
+                if (!strcmp(assets[a].output(), output + 1)) {
+                    assets[a].cached = true;
+                    assets[a].cached_hash = hash;
+                }
+        }
+
+    std::mutex print_mutex;
+    u32 done_count = 0;
+    auto start = std::chrono::steady_clock::now();
+    parallelForEach(asset_count, [&](u32 a) {
+        Asset &asset = assets[a];
+        auto asset_start = std::chrono::steady_clock::now();
+        const Converter &converter = converters[asset.converter_index];
+
+        asset.hash = converter.hash;
+        for (u32 t = 3; t < asset.token_count; t++) asset.hash = hashBytes(asset.tokens[t], strlen(asset.tokens[t]) + 1, asset.hash);
+        if (!converter.found || !hashFile(asset.input(), asset.hash))
+            asset.status = AssetStatus_Failed;
+        else if (asset.cached && asset.cached_hash == asset.hash && os::getFileSizeWithoutOpening(asset.output()) >= 0)
+            asset.status = AssetStatus_UpToDate;
+        else {
+            char command_line[ASSET_COMMAND_LINE_SIZE];
+            u32 length = (u32)snprintf(command_line, ASSET_COMMAND_LINE_SIZE, "\"%s%s" CONVERTER_EXTENSION "\"", converters_directory, asset.converter());
+            for (u32 t = 1; t < asset.token_count && length < ASSET_COMMAND_LINE_SIZE; t++)
+                length += (u32)snprintf(command_line + length, ASSET_COMMAND_LINE_SIZE - length, " \"%s\"", asset.tokens[t]);
+
+            // Converters do not all report failures through their exit code, so the output is checked too
+            // (after removing any previous one, so that a stale output can not pass for a fresh one):
+            remove(asset.output());
+            asset.status = length < ASSET_COMMAND_LINE_SIZE && os::runProcess(command_line) == 0 &&
+                           os::getFileSizeWithoutOpening(asset.output()) > 0 ? AssetStatus_Converted : AssetStatus_Failed;
+        }
+        asset.seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - asset_start).count();
+
+        std::lock_guard<std::mutex> lock{print_mutex};
+        const char *status = asset.status == AssetStatus_Converted ? "converted" : (asset.status == AssetStatus_UpToDate ? "up to date" : "FAILED");
+        printf("[%lu/%lu] %-10s %8.3fs  %s\n", (unsigned long)++done_count, (unsigned long)asset_count, status, asset.seconds, asset.output());
+    }, thread_count);
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    // Failed assets are left out of the cache, so they are converted again next time:
+    u32 counts[3] = {};
+    FILE *cache_file = fopen(cache_file_path, "w");
+    for (u32 a = 0; a < asset_count; a++) {
+        counts[assets[a].status]++;
+        if (cache_file && assets[a].status != AssetStatus_Failed)
+            fprintf(cache_file, "%016llx %s\n", (unsigned long long)assets[a].hash, assets[a].output());
+    }
+    if (cache_file) fclose(cache_file);
+    printf("%lu converted, %lu up to date, %lu failed in %.3fs\n",
+           (unsigned long)counts[AssetStatus_Converted],
+           (unsigned long)counts[AssetStatus_UpToDate],
+           (unsigned long)counts[AssetStatus_Failed], seconds);
+
+    delete[] assets;
+    delete[] lines;
+    delete[] manifest;
+    delete[] cache_lines;
+    delete[] cache;
+
+    return counts[AssetStatus_Failed] ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || !strcmp(argv[1], (char*)"--help")) {
+        printf((char*)("A manifest file path needs to be provided, with a line per asset: "
+                       "The converter (obj2mesh, bmp2texture, bmp2image or stb2image) then its arguments, "
+                       "an optional flag '-j<int>' for the number of assets to convert at once (one per core by default), "
+                       "an optional flag '-force' for converting even the assets that are up to date"));
+        return argc < 2;
+    }
+
+    u32 thread_count = 0;
+    bool force = false;
+    for (u32 i = 2; i < (u32)argc; i++)
+        if (!strncmp(argv[i], (char*)"-j", 2)) thread_count = (u32)atoi(argv[i] + 2);
+        else if (!strcmp(argv[i], (char*)"-force")) force = true;
+
+    // Converters are looked up in this executable's directory:
+    char converters_directory[ASSET_PATH_SIZE];
+    strncpy(converters_directory, argv[0], ASSET_PATH_SIZE - 1);
+    converters_directory[ASSET_PATH_SIZE - 1] = 0;
+    char *end = converters_directory;
+    for (char *c = converters_directory; *c; c++) if (*c == '/' || *c == '\\') end = c + 1;
+    *end = 0;
+
+    return convertAssets(argv[1], converters_directory, thread_count, force);
+}
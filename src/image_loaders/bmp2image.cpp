@@ -1,4 +1,5 @@
 #include "./slim/platforms/win32_bitmap.h"
+#include "./slim/core/image_conversion.h"
 #include "./slim/serialization/image.h"
 
 int main(int argc, char *argv[]) {
@@ -8,6 +9,7 @@ int main(int argc, char *argv[]) {
     char* image_file_path = argv[2];
 
     bool byte_color = false;
+    ImageCompression compression = ImageCompression_None;
     for (u8 i = 3; i < (u8)argc; i++)
         if (     argv[i][0] == '-' && argv[i][1] == 'f') info.flags.flip = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'c') info.flags.channel = true;
@@ -15,10 +17,30 @@ int main(int argc, char *argv[]) {
         else if (argv[i][0] == '-' && argv[i][1] == 't') info.flags.tile = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'n') info.flags.normal = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'b') byte_color = true;
+        else if (argv[i][0] == '-' && argv[i][1] == 'z') // -z1, -z4 or -z5 for BC1, BC4 or BC5
+            compression = argv[i][2] == '1' ? ImageCompression_BC1 : (
+                          argv[i][2] == '4' ? ImageCompression_BC4 : (
+                          argv[i][2] == '5' ? ImageCompression_BC5 : ImageCompression_None));
         else return 0;
 
     u8* components = loadBitmap(bitmap_file_path, info);
-    if (byte_color) {
+    if (compression) {
+        // Bitmaps are BGR(A) while compressed images are RGB(A), as the GL reads them:
+        u32 component_count = info.flags.alpha ? 4 : 3;
+        for (u32 i = 0; i < info.size; i++) {
+            u8 *component = components + i * component_count;
+            u8 blue = component[0];
+            component[0] = component[2];
+            component[2] = blue;
+        }
+
+        RawImage image;
+        *((ImageInfo*)(&image)) = info;
+        setCompression(image, compression);
+        image.content = new u8[getCompressedSize(image)];
+        compressImage(components, image, image.content);
+        save(image, image_file_path);
+    } else if (byte_color) {
         ByteColorImage image;
         *((ImageInfo*)(&image)) = info;
         image.content = new ByteColor[image.size];
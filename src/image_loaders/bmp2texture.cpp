@@ -1,17 +1,14 @@
+#include <stdio.h>
+#include <string.h>
+
 #include "./slim/platforms/win32_bitmap.h"
 #include "./slim/serialization/texture.h"
+#include "./slim/core/image_conversion.h"
+#include "./slim/core/parallel.h"
 
 
 struct PixelQuad {
     Pixel TL, TR, BL, BR;
-
-    Color getAverageColor() const {
-        return {
-                0.25f * (TL.color.r + TR.color.r + BL.color.r + BR.color.r),
-                0.25f * (TL.color.g + TR.color.g + BL.color.g + BR.color.g),
-                0.25f * (TL.color.b + TR.color.b + BL.color.b + BR.color.b)
-        };
-    }
 };
 
 enum CubeMapLoaderMode {
@@ -26,18 +23,20 @@ struct TextureMipLoader {
     Pixel *texels;
     PixelQuad *texel_quads;
 
-    void init(u32 Width, u32 Height) {
+    static u64 GetSizeInBytes(u32 width, u32 height) {
+        return sizeof(Pixel) * width * height + sizeof(PixelQuad) * (width + 1) * (height + 1);
+    }
+
+    void init(u32 Width, u32 Height, memory::MonotonicAllocator *memory_allocator) {
         width = Width;
         height = Height;
-        texels = new Pixel[width * height];
-        texel_quads = new PixelQuad[(width + 1) * (height + 1)];
+        texels = (Pixel*)memory_allocator->allocate(sizeof(Pixel) * width * height);
+        texel_quads = (PixelQuad*)memory_allocator->allocate(sizeof(PixelQuad) * (width + 1) * (height + 1));
     }
 
-    void load(bool wrap,
-              CubeMapLoaderMode cube_map_loader_mode = CubeMapLoaderMode_None,
-              Pixel *main_faces_texels = nullptr,
-              Pixel *top_face_texels = nullptr,
-              Pixel *bottom_face_texels = nullptr) {
+    // Each quad corner is written while loading exactly one row of texels (wrapping only crosses
+    // between the first and last rows, into corners no other row touches), so rows load in parallel:
+    void loadRows(bool wrap, u32 first_row, u32 end_row) {
         PixelQuad *TL, *TR, *BL, *BR;
         bool L, R, T, B;
         const u32 stride = width + 1;
@@ -45,11 +44,11 @@ struct TextureMipLoader {
         const u32 last_y = height - 1;
         const u32 l = 0;
         const u32 r = width;
-        Pixel *texel = texels;
+        Pixel *texel = texels + first_row * width;
         PixelQuad *top_line = texel_quads;
         PixelQuad *bottom_line = top_line + height * stride;
-        PixelQuad *current_line = top_line, *next_line = top_line + stride;
-        for (u32 y = 0; y < height; y++, current_line += stride, next_line += stride) {
+        PixelQuad *current_line = top_line + first_row * stride, *next_line = current_line + stride;
+        for (u32 y = first_row; y < end_row; y++, current_line += stride, next_line += stride) {
             T = (y == 0);
             B = (y == last_y);
 
@@ -93,11 +92,21 @@ struct TextureMipLoader {
                 }
             }
         }
+    }
+
+    void load(bool wrap,
+              CubeMapLoaderMode cube_map_loader_mode = CubeMapLoaderMode_None,
+              Pixel *main_faces_texels = nullptr,
+              Pixel *top_face_texels = nullptr,
+              Pixel *bottom_face_texels = nullptr) {
+        parallelFor(height, [&](u32 first_row, u32 end_row) { loadRows(wrap, first_row, end_row); });
 
         if (cube_map_loader_mode) {
+            PixelQuad *top_line = texel_quads;
+            PixelQuad *bottom_line = top_line + height * (width + 1);
             u32 h = height;
             u32 w = h;
-            u32 quad_w = (w + 1) * 4;
+            u32 quad_w = w * 4 + 1;
             u32 s = w * h;
             u32 last        = w - 1;
             u32 last_row    = w * last;
@@ -198,37 +207,43 @@ struct TextureMipLoader {
     }
 };
 
-void loadMips(Texture &texture, TextureMipLoader *mips) {
+// Box-filters 2x2 texels of the source into each texel of the next mip. Texels are linear (gamma is
+// removed when the components are loaded), so averaging them is gamma-correct. Pixels are 4 floats:
+void downsampleRows(const TextureMipLoader &source, TextureMipLoader &target, u32 first_row, u32 end_row) {
+    for (u32 y = first_row; y < end_row; y++) {
+        const Pixel *top    = source.texels + source.width * (y * 2);
+        const Pixel *bottom = top + source.width;
+        Pixel *texel = target.texels + target.width * y;
+        for (u32 x = 0; x < target.width; x++, texel++, top += 2, bottom += 2) {
+#ifdef SLIM_SIMD
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&top[0].color.r), _mm_loadu_ps(&top[1].color.r)),
+                                    _mm_add_ps(_mm_loadu_ps(&bottom[0].color.r), _mm_loadu_ps(&bottom[1].color.r)));
+            _mm_storeu_ps(&texel->color.r, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+            texel->color.r = 0.25f * (top[0].color.r + top[1].color.r + bottom[0].color.r + bottom[1].color.r);
+            texel->color.g = 0.25f * (top[0].color.g + top[1].color.g + bottom[0].color.g + bottom[1].color.g);
+            texel->color.b = 0.25f * (top[0].color.b + top[1].color.b + bottom[0].color.b + bottom[1].color.b);
+            texel->opacity = 0.25f * (top[0].opacity + top[1].opacity + bottom[0].opacity + bottom[1].opacity);
+#endif
+        }
+    }
+}
+
+void loadMips(Texture &texture, TextureMipLoader *mips, memory::MonotonicAllocator *memory_allocator) {
     TextureMipLoader *current_mip = mips;
     TextureMipLoader *next_mip = current_mip + 1;
 
     u32 mip_width  = texture.width;
     u32 mip_height = texture.height;
 
-    PixelQuad *colors_quad;
-    u32 stride, offset, start;
-
     while (mip_width > 4 && mip_height > 4) {
-        start = mip_width + 1;
-        stride = start * 2;
-
         mip_width  /= 2;
         mip_height /= 2;
 
-        next_mip->init(mip_width, mip_height);
-
-        for (u32 y = 0; y < mip_height; y++) {
-            offset = start + 1;
-
-            for (u32 x = 0; x < mip_width; x++) {
-                colors_quad = current_mip->texel_quads + offset;
-                next_mip->texels[mip_width * y + x].color = colors_quad->getAverageColor();
-                offset += 2;
-            }
-
-            start += stride;
-        }
-
+        next_mip->init(mip_width, mip_height, memory_allocator);
+        parallelFor(mip_height, [&](u32 first_row, u32 end_row) {
+            downsampleRows(*current_mip, *next_mip, first_row, end_row);
+        });
         next_mip->load(texture.flags.wrap);
 
         current_mip++;
@@ -236,8 +251,43 @@ void loadMips(Texture &texture, TextureMipLoader *mips) {
     }
 }
 
+// Loads the 6 faces of a cube map from separate bitmaps (each oriented as a GL cube map face), where the '*' in
+// the path pattern stands for each face's name, and packs them into the strip that cube maps are converted from:
+u8* loadCubeMapFaces(char *path_pattern, ImageInfo &info) {
+    const char *star = strchr(path_pattern, '*');
+    if (!star) return nullptr;
+
+    CubeMapImages faces;
+    RawImage *face_images[6] = {&faces.pos_x, &faces.neg_x, &faces.pos_y, &faces.neg_y, &faces.pos_z, &faces.neg_z};
+    const char *face_names[6] = {"pos_x", "neg_x", "pos_y", "neg_y", "pos_z", "neg_z"};
+    char path[1024];
+    bool loaded = true;
+    for (u32 f = 0; f < 6; f++) {
+        RawImage &face = *face_images[f];
+        face = RawImage{};
+        face.flags.flip = info.flags.flip;
+        snprintf(path, sizeof(path), "%.*s%s%s", (int)(star - path_pattern), path_pattern, face_names[f], star + 1);
+        face.content = loadBitmap(path, face);
+        if (!face.content) printf("Cube map face not found: %s\n", path);
+        loaded = loaded && face.content && face.width == face.height &&
+                 face.width == faces.pos_x.width && face.flags.alpha == faces.pos_x.flags.alpha;
+    }
+
+    u8 *components = nullptr;
+    if (loaded) {
+        info.flags.alpha = faces.pos_x.flags.alpha;
+        info.updateDimensions(faces.pos_x.width * 6, faces.pos_x.height);
+        components = new u8[(info.flags.alpha ? 4 : 3) * info.size];
+        packCubeMapFaces(faces, components);
+    }
+    for (u32 f = 0; f < 6; f++) delete[] face_images[f]->content;
+
+    return components;
+}
+
 int main(int argc, char *argv[]) {
     Texture texture;
+    bool separate_faces = false;
 
     char* bitmap_file_path = argv[1];
     char* texture_file_path = argv[2];
@@ -249,12 +299,18 @@ int main(int argc, char *argv[]) {
         else if (argv[i][0] == '-' && argv[i][1] == 'w') texture.flags.wrap = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'n') texture.flags.normal = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'c') texture.flags.cubemap = true;
+        else if (argv[i][0] == '-' && argv[i][1] == 's') texture.flags.cubemap = separate_faces = true;
         else return 0;
     }
 
-    u8* components = loadBitmap(bitmap_file_path, texture);
+    u8* components = separate_faces ? loadCubeMapFaces(bitmap_file_path, texture) : loadBitmap(bitmap_file_path, texture);
+    if (!components) return 1;
     TextureMipLoader *loader_mips = nullptr;
 
+    // The loader mips of the whole chain (texels and quads) share a single allocation:
+    memory::MonotonicAllocator memory_allocator;
+    u64 memory_size;
+
     texture.flags.channel = false;
     if (texture.flags.cubemap) {
         texture.flags.wrap = false;
@@ -266,12 +322,17 @@ int main(int argc, char *argv[]) {
         u32 face_width = texture.height;
         u32 main_width = face_width * 4;
 
+        memory_size = sizeof(Pixel) * texture.width * texture.height +
+                      TextureMipLoader::GetSizeInBytes(main_width, texture.height) +
+                      TextureMipLoader::GetSizeInBytes(face_width, texture.height) * 2;
+        memory_allocator = memory::MonotonicAllocator{memory_size};
+
         loader_mips = new TextureMipLoader[3];
-        loader_mips[0].init(main_width, texture.height);
-        loader_mips[1].init(face_width, texture.height);
-        loader_mips[2].init(face_width, texture.height);
+        loader_mips[0].init(main_width, texture.height, &memory_allocator);
+        loader_mips[1].init(face_width, texture.height, &memory_allocator);
+        loader_mips[2].init(face_width, texture.height, &memory_allocator);
 
-        Pixel *all_texels = new Pixel[texture.width * texture.height];
+        Pixel *all_texels = (Pixel*)memory_allocator.allocate(sizeof(Pixel) * texture.width * texture.height);
         componentsToPixels(components, texture, all_texels);
 
         Pixel *texel = all_texels;
@@ -284,34 +345,40 @@ int main(int argc, char *argv[]) {
                 else
                     loader_mips[2].texels[(texture.height * y) + (x - (main_width + face_width))] = *texel;
 
-        delete[] all_texels;
         loader_mips[0].load(texture.flags.wrap, CubeMapLoaderMode_Main, nullptr, loader_mips[1].texels, loader_mips[2].texels);
         loader_mips[1].load(texture.flags.wrap, CubeMapLoaderMode_Top, loader_mips[0].texels);
         loader_mips[2].load(texture.flags.wrap, CubeMapLoaderMode_Bottom, loader_mips[0].texels);
     } else {
         texture.mip_count = 1;
+        memory_size = TextureMipLoader::GetSizeInBytes(texture.width, texture.height);
         if (texture.flags.mipmap) {
             u32 mip_width  = texture.width;
             u32 mip_height = texture.height;
             while (mip_width > 4 && mip_height > 4) {
                 mip_width /= 2;
                 mip_height /= 2;
+                memory_size += TextureMipLoader::GetSizeInBytes(mip_width, mip_height);
                 texture.mip_count++;
             }
         }
+        memory_allocator = memory::MonotonicAllocator{memory_size};
 
-        auto *mips = new TextureMipLoader[texture.mip_count];
-        mips->init(texture.width, texture.height);
+        loader_mips = new TextureMipLoader[texture.mip_count];
+        TextureMipLoader *mips = loader_mips;
+        mips->init(texture.width, texture.height, &memory_allocator);
         componentsToPixels(components, texture, mips->texels);
 
         mips->load(texture.flags.wrap);
-        if (texture.flags.mipmap) loadMips(texture, mips);
+        if (texture.flags.mipmap) loadMips(texture, mips, &memory_allocator);
     }
 
     // Create final mips with 8-bit per channel from the float channels in the mip loaders:
     texture.mips = new TextureMip[texture.mip_count];
     TextureMip *mip = texture.mips;
     TextureMipLoader *loader_mip = loader_mips;
+#ifdef SLIM_TEXEL_QUADS
+    texture.flags.apron = false;
+    texture.flags.tile = false;
     for (u16 i = 0; i < texture.mip_count; i++, mip++, loader_mip++) {
         mip->width  = loader_mip->width;
         mip->height = loader_mip->height;
@@ -339,6 +406,34 @@ int main(int argc, char *argv[]) {
 
         }
     }
+#else
+    // The loader's quads hold each texel of the apron-padded grid in a consistent way, so quad (x, y)
+    // covers padded texels x..x+1 and y..y+1: Take each padded texel once, from the quad that has it
+    // at its bottom-right (or from the first row/column of quads for the top/left of the apron).
+    // Tiled textures get their texels written in 4x4 block order (see TextureMip::texelOffset):
+    texture.flags.apron = true;
+    for (u16 i = 0; i < texture.mip_count; i++, mip++, loader_mip++) {
+        mip->width  = loader_mip->width;
+        mip->height = loader_mip->height;
+        mip->tiled  = texture.flags.tile;
+        mip->texels = new Texel[TextureMip::GetSizeInBytes(mip->width, mip->height, mip->tiled) / sizeof(Texel)]();
+
+        const u32 quads_stride = mip->width + 1;
+        parallelFor(mip->height + 2, [&](u32 first_row, u32 end_row) {
+            for (u32 y = first_row; y < end_row; y++) {
+                for (u32 x = 0; x < mip->width + 2; x++) {
+                    Texel *texel = mip->texels + mip->texelOffset(x, y);
+                    const PixelQuad &quad = loader_mip->texel_quads[(y ? y - 1 : 0) * quads_stride + (x ? x - 1 : 0)];
+                    const Pixel &pixel = y ? (x ? quad.BR : quad.BL) : (x ? quad.TR : quad.TL);
+                    texel->R = (u8)(pixel.color.r * FLOAT_TO_COLOR_COMPONENT);
+                    texel->G = (u8)(pixel.color.g * FLOAT_TO_COLOR_COMPONENT);
+                    texel->B = (u8)(pixel.color.b * FLOAT_TO_COLOR_COMPONENT);
+                    texel->A = 255;
+                }
+            }
+        });
+    }
+#endif
 
     save(texture, texture_file_path);
 
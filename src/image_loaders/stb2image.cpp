@@ -1,5 +1,5 @@
 #include "stb_image_loader.h"
-#include "../slim/core/image.h"
+#include "../slim/core/image_conversion.h"
 #include "../slim/serialization/image.h"
 #include "../slim/platforms/win32_base.h"
 
@@ -12,6 +12,7 @@ int main(int argc, char *argv[]) {
 
     bool byte_color = false;
     bool raw = false;
+    ImageCompression compression = ImageCompression_None;
     for (u8 i = 3; i < (u8)argc; i++)
         if (     argv[i][0] == '-' && argv[i][1] == 'f') info.flags.flip = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'c') info.flags.channel = true;
@@ -20,10 +21,21 @@ int main(int argc, char *argv[]) {
         else if (argv[i][0] == '-' && argv[i][1] == 'n') info.flags.normal = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'b') byte_color = true;
         else if (argv[i][0] == '-' && argv[i][1] == 'r') raw = true;
+        else if (argv[i][0] == '-' && argv[i][1] == 'z') // -z1, -z4 or -z5 for BC1, BC4 or BC5
+            compression = argv[i][2] == '1' ? ImageCompression_BC1 : (
+                          argv[i][2] == '4' ? ImageCompression_BC4 : (
+                          argv[i][2] == '5' ? ImageCompression_BC5 : ImageCompression_None));
         else return 0;
 
     u8* components = readImageComponents(bitmap_file_path, info);
-    if (raw) {
+    if (compression) {
+        RawImage image;
+        *((ImageInfo*)(&image)) = info;
+        setCompression(image, compression);
+        image.content = new u8[getCompressedSize(image)];
+        compressImage(components, image, image.content);
+        save(image, image_file_path);
+    } else if (raw) {
         RawImage image;
         *((ImageInfo*)(&image)) = info;
         image.content = components;
@@ -9,34 +9,441 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <unordered_set>
 
 #include "./slim/platforms/win32_base.h"
+#include "./slim/core/parallel.h"
+#include "./slim/core/radix_sort.h"
 #include "./slim/scene/bvh_builder.h"
+#include "./slim/scene/mesh_simplifier.h"
 #include "./slim/serialization/mesh.h"
 
 // Or using the single-header file:
 // #include "../slim.h"
 
-enum VertexAttributes {
-    VertexAttributes_None,
-    VertexAttributes_Positions,
-    VertexAttributes_PositionsAndUVs,
-    VertexAttributes_PositionsUVsAndNormals
+// The OBJ file is memory-mapped and split into chunks at line boundaries. A first parallel pass counts the
+// elements of each chunk, prefix sums over these counts give each chunk where its elements go in the mesh,
+// and a second parallel pass parses the chunks straight into the mesh's memory.
+#define OBJ_CHUNK_SIZE Megabytes(4)
+
+struct OBJChunk {
+    const char *start;
+    const char *end;
+
+    // Counted by the first pass, then turned into the index of the chunk's first element of each kind:
+    u32 vertex_count;
+    u32 uvs_count;
+    u32 normals_count;
+    u32 triangle_count;
+};
+
+INLINE bool isSpace(char character) { return character == ' ' || character == '\t'; }
+
+INLINE const char* skipSpaces(const char *character, const char *end) {
+    while (character < end && isSpace(*character)) character++;
+    return character;
+}
+
+INLINE const char* skipLine(const char *character, const char *end) {
+    const char *new_line = (const char*)memchr(character, '\n', end - character);
+    return new_line ? new_line + 1 : end;
+}
+
+const char* parseInt(const char *character, const char *end, int &value) {
+    bool negative = character < end && *character == '-';
+    if (negative || (character < end && *character == '+')) character++;
+
+    value = 0;
+    for (; character < end && *character >= '0' && *character <= '9'; character++)
+        value = value * 10 + (*character - '0');
+    if (negative) value = -value;
+
+    return character;
+}
+
+const char* parseFloat(const char *character, const char *end, f32 &value) {
+    static const f64 powers_of_10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    character = skipSpaces(character, end);
+    bool negative = character < end && *character == '-';
+    if (negative || (character < end && *character == '+')) character++;
+
+    // Up to 19 significant digits are accumulated exactly, the rest only shift the exponent:
+    u64 mantissa = 0;
+    int digit_count = 0;
+    int exponent = 0;
+    for (; character < end && *character >= '0' && *character <= '9'; character++)
+        if (digit_count < 19) {
+            mantissa = mantissa * 10 + (*character - '0');
+            if (mantissa) digit_count++;
+        } else exponent++;
+
+    if (character < end && *character == '.')
+        for (character++; character < end && *character >= '0' && *character <= '9'; character++)
+            if (digit_count < 19) {
+                mantissa = mantissa * 10 + (*character - '0');
+                if (mantissa) digit_count++;
+                exponent--;
+            }
+
+    if (character < end && (*character == 'e' || *character == 'E')) {
+        int explicit_exponent;
+        character = parseInt(character + 1, end, explicit_exponent);
+        exponent += explicit_exponent;
+    }
+
+    f64 result = (f64)mantissa;
+    if (exponent) {
+        if (exponent < 0) result = -exponent <= 22 ? result / powers_of_10[-exponent] : result * pow(10.0, exponent);
+        else              result =  exponent <= 22 ? result * powers_of_10[ exponent] : result * pow(10.0, exponent);
+    }
+    value = (f32)(negative ? -result : result);
+
+    return character;
+}
+
+// Parses a face vertex as "v", "v/t", "v//n" or "v/t/n", resolving negative (relative) indices
+// against the counts of elements before the face. Missing indices are left at 0:
+const char* parseFaceVertex(const char *character, const char *end, int *indices, const u32 *counts) {
+    indices[0] = indices[1] = indices[2] = 0;
+    character = parseInt(skipSpaces(character, end), end, indices[0]);
+    for (u8 i = 1; i < 3 && character < end && *character == '/'; i++) {
+        character++;
+        if (character < end && *character != '/' && !isSpace(*character))
+            character = parseInt(character, end, indices[i]);
+    }
+    for (u8 i = 0; i < 3; i++)
+        if (indices[i] < 0) indices[i] += (int)counts[i] + 1;
+
+    return character;
+}
+
+void countChunk(OBJChunk &chunk) {
+    chunk.vertex_count = chunk.uvs_count = chunk.normals_count = chunk.triangle_count = 0;
+    const char *end = chunk.end;
+    for (const char *line = chunk.start; line < end; line = skipLine(line, end)) {
+        if (end - line < 2) continue;
+        if (line[0] == 'f' && isSpace(line[1])) chunk.triangle_count++;
+        else if (line[0] == 'v') {
+            if (isSpace(line[1])) chunk.vertex_count++;
+            else if (end - line > 2 && isSpace(line[2])) {
+                if (line[1] == 't') chunk.uvs_count++;
+                if (line[1] == 'n') chunk.normals_count++;
+            }
+        }
+    }
+}
+
+void parseChunk(const OBJChunk &chunk, Mesh &mesh, const u8 *triangle_vertex_ids) {
+    vec3 *vertex_position = mesh.vertex_positions + chunk.vertex_count;
+    vec3 *vertex_normal   = mesh.vertex_normals   + chunk.normals_count;
+    vec2 *vertex_uvs      = mesh.vertex_uvs       + chunk.uvs_count;
+    TriangleVertexIndices *vertex_position_indices = mesh.vertex_position_indices + chunk.triangle_count;
+    TriangleVertexIndices *vertex_normal_indices   = mesh.vertex_normal_indices ? mesh.vertex_normal_indices + chunk.triangle_count : nullptr;
+    TriangleVertexIndices *vertex_uvs_indices      = mesh.vertex_uvs_indices    ? mesh.vertex_uvs_indices    + chunk.triangle_count : nullptr;
+
+    // Elements before the current line, for resolving relative indices (in face vertex order):
+    u32 counts[3] = {chunk.vertex_count, chunk.uvs_count, chunk.normals_count};
+    int indices[3];
+
+    const char *end = chunk.end;
+    for (const char *line = chunk.start; line < end; line = skipLine(line, end)) {
+        if (end - line < 2) continue;
+        if (line[0] == 'v' && isSpace(line[1])) {
+            const char *character = parseFloat(line + 2, end, vertex_position->x);
+            character = parseFloat(character, end, vertex_position->y);
+            parseFloat(character, end, vertex_position->z);
+            vertex_position++;
+            counts[0]++;
+        } else if (line[0] == 'v' && line[1] == 'n' && end - line > 2 && isSpace(line[2])) {
+            const char *character = parseFloat(line + 3, end, vertex_normal->x);
+            character = parseFloat(character, end, vertex_normal->y);
+            parseFloat(character, end, vertex_normal->z);
+            vertex_normal++;
+            counts[2]++;
+        } else if (line[0] == 'v' && line[1] == 't' && end - line > 2 && isSpace(line[2])) {
+            const char *character = parseFloat(line + 3, end, vertex_uvs->x);
+            parseFloat(character, end, vertex_uvs->y);
+            vertex_uvs++;
+            counts[1]++;
+        } else if (line[0] == 'f' && isSpace(line[1])) {
+            // Only the first 3 vertices of a face are used
+            const char *character = line + 2;
+            for (u8 i = 0; i < 3; i++) {
+                const u8 id = triangle_vertex_ids[i];
+                character = parseFaceVertex(character, end, indices, counts);
+                vertex_position_indices->ids[id] = indices[0] - 1;
+                if (vertex_uvs_indices)    vertex_uvs_indices->ids[id]    = indices[1] - 1;
+                if (vertex_normal_indices) vertex_normal_indices->ids[id] = indices[2] - 1;
+            }
+            vertex_position_indices++;
+            if (vertex_uvs_indices) vertex_uvs_indices++;
+            if (vertex_normal_indices) vertex_normal_indices++;
+        }
+    }
+}
+
+// Each triangle edge is keyed by its (lower, higher) vertex index pair. The keys are radix-sorted and
+// de-duplicated, so shared edges merge without hashing and come out in a deterministic order:
+#define EDGE_DEDUPLICATION_BLOCK_SIZE 65536
+
+void extractEdges(Mesh &mesh) {
+    const u32 key_count = mesh.triangle_count * 3;
+    const u32 vertex_bits = getBitCount(mesh.vertex_count ? mesh.vertex_count - 1 : 0);
+    const u64 vertex_mask = ((u64)1 << vertex_bits) - 1;
+    u64 *keys = new u64[key_count * 2];
+
+    parallelFor(mesh.triangle_count, [&](u32 first_triangle, u32 end_triangle) {
+        for (u32 f = first_triangle; f < end_triangle; f++) {
+            const u32 *vertex_indices = mesh.vertex_position_indices[f].ids;
+            for (u8 from = 0, to = 1; from < 3; from++, to = (to + 1) % 3) {
+                u64 from_index = vertex_indices[from] & vertex_mask;
+                u64 to_index   = vertex_indices[to]   & vertex_mask;
+                keys[f * 3 + from] = from_index < to_index ?
+                    (from_index << vertex_bits) | to_index :
+                    (to_index << vertex_bits) | from_index;
+            }
+        }
+    }, 1024);
+
+    const u64 *sorted_keys = radixSort(keys, keys + key_count, key_count, vertex_bits * 2);
+
+    // Count the first occurrences of keys per block, then write each block's edges after the previous blocks':
+    const u32 block_count = (key_count + EDGE_DEDUPLICATION_BLOCK_SIZE - 1) / EDGE_DEDUPLICATION_BLOCK_SIZE;
+    u32 *block_offsets = new u32[block_count + 1];
+    parallelFor(block_count, [&](u32 first_block, u32 end_block) {
+        for (u32 b = first_block; b < end_block; b++) {
+            const u32 end = Min(key_count, (b + 1) * EDGE_DEDUPLICATION_BLOCK_SIZE);
+            u32 edge_count = 0;
+            for (u32 i = b * EDGE_DEDUPLICATION_BLOCK_SIZE; i < end; i++)
+                if (!i || sorted_keys[i] != sorted_keys[i - 1]) edge_count++;
+            block_offsets[b + 1] = edge_count;
+        }
+    }, 1);
+
+    block_offsets[0] = 0;
+    for (u32 b = 0; b < block_count; b++) block_offsets[b + 1] += block_offsets[b];
+    mesh.edge_count = block_offsets[block_count];
+
+    parallelFor(block_count, [&](u32 first_block, u32 end_block) {
+        for (u32 b = first_block; b < end_block; b++) {
+            const u32 end = Min(key_count, (b + 1) * EDGE_DEDUPLICATION_BLOCK_SIZE);
+            EdgeVertexIndices *edge = mesh.edge_vertex_indices + block_offsets[b];
+            for (u32 i = b * EDGE_DEDUPLICATION_BLOCK_SIZE; i < end; i++)
+                if (!i || sorted_keys[i] != sorted_keys[i - 1]) {
+                    edge->from = (u32)(sorted_keys[i] >> vertex_bits);
+                    edge->to   = (u32)(sorted_keys[i] & vertex_mask);
+                    edge++;
+                }
+        }
+    }, 1);
+
+    delete[] block_offsets;
+    delete[] keys;
+}
+
+// Positions are scaled, rotated and centered on the origin (and normals rotated) in a single parallel pass, after
+// a parallel reduction of the bounds that centering needs:
+#define VERTEX_TRANSFORM_BLOCK_SIZE 65536
+
+void transformVertices(Mesh &mesh, f32 scale, f32 rotY) {
+    const mat3 rotation = mat3::RotationAroundY(rotY * DEG_TO_RAD);
+    auto transformed = [&](vec3 position) {
+        position *= scale;
+        return rotY ? rotation * position : position;
+    };
+
+    const u32 block_count = (mesh.vertex_count + VERTEX_TRANSFORM_BLOCK_SIZE - 1) / VERTEX_TRANSFORM_BLOCK_SIZE;
+    AABB *block_bounds = new AABB[block_count];
+    parallelFor(block_count, [&](u32 first_block, u32 end_block) {
+        for (u32 b = first_block; b < end_block; b++) {
+            AABB &bounds = block_bounds[b];
+            bounds.min = INFINITY;
+            bounds.max = -INFINITY;
+            const u32 end = Min(mesh.vertex_count, (b + 1) * VERTEX_TRANSFORM_BLOCK_SIZE);
+            for (u32 i = b * VERTEX_TRANSFORM_BLOCK_SIZE; i < end; i++) {
+                const vec3 position = transformed(mesh.vertex_positions[i]);
+                bounds.min = minimum(bounds.min, position);
+                bounds.max = maximum(bounds.max, position);
+            }
+        }
+    }, 1);
+
+    mesh.aabb.min = INFINITY;
+    mesh.aabb.max = -INFINITY;
+    for (u32 b = 0; b < block_count; b++) {
+        mesh.aabb.min = minimum(mesh.aabb.min, block_bounds[b].min);
+        mesh.aabb.max = maximum(mesh.aabb.max, block_bounds[b].max);
+    }
+    delete[] block_bounds;
+
+    const vec3 centroid = (mesh.aabb.min + mesh.aabb.max) / 2.0f;
+    mesh.aabb.min -= centroid;
+    mesh.aabb.max -= centroid;
+
+    parallelFor(Max(mesh.vertex_count, mesh.normals_count), [&](u32 first, u32 end) {
+        for (u32 i = first; i < end; i++) {
+            if (i < mesh.vertex_count) mesh.vertex_positions[i] = transformed(mesh.vertex_positions[i]) - centroid;
+            if (i < mesh.normals_count && rotY) mesh.vertex_normals[i] = rotation * mesh.vertex_normals[i];
+        }
+    }, VERTEX_TRANSFORM_BLOCK_SIZE);
+}
+
+// A tangent is shared by the triangle corners having the same position, uv, normal and handedness (which is
+// not stored, see loadVertices in gl_mesh.h). It is the sum of their triangles' tangents, made orthogonal to
+// the normal (Gram-Schmidt). Triangles are processed in parallel, then corners are merged through a hash
+// table, then tangents are summed in parallel over corners grouped by tangent:
+struct TangentKey {
+    u32 position, uv, normal, handedness;
 };
 
-int obj2mesh(char* obj_file_path, char* mesh_file_path, bool invert_winding_order = false, f32 scale = 1, float rotY = 0) {
-    const u8 v1_id = 0;
-    const u8 v2_id = invert_winding_order ? 2 : 1;
-    const u8 v3_id = invert_winding_order ? 1 : 2;
+INLINE u32 hashTangentKey(const TangentKey &key) {
+    u32 hash = 2166136261u;
+    hash = (hash ^ key.position)   * 16777619u;
+    hash = (hash ^ key.uv)         * 16777619u;
+    hash = (hash ^ key.normal)     * 16777619u;
+    hash = (hash ^ key.handedness) * 16777619u;
+    return hash ^ (hash >> 15);
+}
 
-    int vertex_indices[3];
-    int normal_indices[3];
-    int uvs_indices[3];
+void generateTangents(Mesh &mesh) {
+    if (!mesh.uvs_count || !mesh.normals_count) {
+        mesh.tangents_count = 0;
+        return;
+    }
 
-    u32 f, t;
+    const u32 corner_count = mesh.triangle_count * 3;
+    vec3 *triangle_tangents = new vec3[mesh.triangle_count];
+    TangentKey *keys = new TangentKey[corner_count];
+    parallelFor(mesh.triangle_count, [&](u32 first_triangle, u32 end_triangle) {
+        vec3 bitangent;
+        for (u32 t = first_triangle; t < end_triangle; t++) {
+            const TriangleVertexIndices &position_ids = mesh.vertex_position_indices[t];
+            const TriangleVertexIndices &uv_ids = mesh.vertex_uvs_indices[t];
+            const TriangleVertexIndices &normal_ids = mesh.vertex_normal_indices[t];
+            getTriangleTangents(mesh.vertex_positions[position_ids.v1], mesh.vertex_positions[position_ids.v2], mesh.vertex_positions[position_ids.v3],
+                                mesh.vertex_uvs[uv_ids.v1], mesh.vertex_uvs[uv_ids.v2], mesh.vertex_uvs[uv_ids.v3],
+                                triangle_tangents[t], bitangent);
+            for (u8 i = 0; i < 3; i++) {
+                const vec3 &normal = mesh.vertex_normals[normal_ids.ids[i]];
+                keys[t * 3 + i] = {position_ids.ids[i], uv_ids.ids[i], normal_ids.ids[i],
+                                   getTangentHandedness(normal, triangle_tangents[t], bitangent) < 0 ? 0u : 1u};
+            }
+        }
+    }, 1024);
+
+    u32 table_size = 1;
+    while (table_size < corner_count * 2) table_size <<= 1;
+    const u32 slot_mask = table_size - 1;
+    u32 *table = new u32[table_size];
+    for (u32 i = 0; i < table_size; i++) table[i] = INVALID_VERTEX_INDEX;
+
+    TangentKey *unique_keys = new TangentKey[corner_count];
+    u32 *first_corners = new u32[corner_count + 1];
+    u32 tangent_count = 0;
+    for (u32 c = 0; c < corner_count; c++) {
+        const TangentKey &key = keys[c];
+        u32 &tangent_index = mesh.vertex_tangent_indices[c / 3].ids[c % 3];
+        for (u32 slot = hashTangentKey(key) & slot_mask; ; slot = (slot + 1) & slot_mask) {
+            const u32 unique_index = table[slot];
+            if (unique_index == INVALID_VERTEX_INDEX) {
+                table[slot] = tangent_index = tangent_count;
+                unique_keys[tangent_count] = key;
+                first_corners[++tangent_count] = 0;
+                break;
+            }
+            const TangentKey &unique_key = unique_keys[unique_index];
+            if (unique_key.position == key.position && unique_key.uv == key.uv &&
+                unique_key.normal == key.normal && unique_key.handedness == key.handedness) {
+                tangent_index = unique_index;
+                break;
+            }
+        }
+        first_corners[tangent_index + 1]++;
+    }
+    delete[] table;
+    delete[] keys;
+
+    // Group the corners by tangent:
+    u32 *corners = new u32[corner_count];
+    first_corners[0] = 0;
+    for (u32 i = 0; i < tangent_count; i++) first_corners[i + 1] += first_corners[i];
+    for (u32 c = 0; c < corner_count; c++) corners[first_corners[mesh.vertex_tangent_indices[c / 3].ids[c % 3]]++] = c;
+    for (u32 i = tangent_count; i; i--) first_corners[i] = first_corners[i - 1];
+    first_corners[0] = 0;
+
+    parallelFor(tangent_count, [&](u32 first_tangent, u32 end_tangent) {
+        for (u32 i = first_tangent; i < end_tangent; i++) {
+            vec3 tangent{0.0f};
+            for (u32 c = first_corners[i]; c < first_corners[i + 1]; c++) tangent += triangle_tangents[corners[c] / 3];
+
+            const vec3 &normal = mesh.vertex_normals[unique_keys[i].normal];
+            tangent -= normal * normal.dot(tangent);
+            const f32 length = tangent.length();
+            if (length > EPS)
+                tangent /= length;
+            else
+                tangent = normal.cross(fabsf(normal.x) < 0.9f ? vec3{1, 0, 0} : vec3{0, 1, 0}).normalized();
+            mesh.vertex_tangents[i] = tangent;
+        }
+    }, 1024);
+    mesh.tangents_count = tangent_count;
 
-    std::unordered_set<u64> edge_hashes;
+    delete[] triangle_tangents;
+    delete[] unique_keys;
+    delete[] first_corners;
+    delete[] corners;
+}
+
+// Each LOD is simplified from the previous one down to half its triangles, then gets reordered for the vertex
+// cache and its own BVH. Stops early once simplification stalls (on locked seams and borders):
+#define LOD_TRIANGLE_RATIO 0.5f
+#define LOD_MIN_TRIANGLE_COUNT 64
+#define LOD_MAX_TRIANGLE_RATIO 0.8f
+
+void generateLODs(Mesh &mesh, u32 lod_count, BVHBuilder &builder) {
+    mesh.lods = new Mesh[lod_count];
+    mesh.lod_count = 0;
+
+    const Mesh *source = &mesh;
+    for (u32 l = 0; l < lod_count; l++) {
+        const u32 target_triangle_count = (u32)((f32)source->triangle_count * LOD_TRIANGLE_RATIO);
+        if (target_triangle_count < LOD_MIN_TRIANGLE_COUNT) break;
+
+        Mesh &lod = mesh.lods[l];
+        lod = mesh.makeLOD(source->triangle_count);
+        lod.vertex_position_indices = new TriangleVertexIndices[lod.triangle_count];
+        if (lod.uvs_count)      lod.vertex_uvs_indices     = new TriangleVertexIndices[lod.triangle_count];
+        if (lod.normals_count)  lod.vertex_normal_indices  = new TriangleVertexIndices[lod.triangle_count];
+        if (lod.tangents_count) lod.vertex_tangent_indices = new TriangleVertexIndices[lod.triangle_count];
+
+        f32 error = simplifyMesh(*source, lod, target_triangle_count);
+        if ((f32)lod.triangle_count > (f32)source->triangle_count * LOD_MAX_TRIANGLE_RATIO) break;
+
+        u32 *triangle_order = new u32[lod.triangle_count];
+        optimizeVertexCache(lod.vertex_position_indices, lod.triangle_count, lod.vertex_count, triangle_order);
+        reorderTriangles(lod, triangle_order);
+        if (lod.tangents_count) {
+            auto *scratch = new TriangleVertexIndices[lod.triangle_count];
+            reorderTriangles(lod.vertex_tangent_indices, lod.triangle_count, triangle_order, scratch);
+            delete[] scratch;
+        }
+        delete[] triangle_order;
+
+        lod.triangles = new Triangle[lod.triangle_count];
+        lod.bvh.nodes = new BVHNode[lod.triangle_count * 2];
+        builder.buildMesh(lod);
+
+        printf("LOD %d: %d triangles (error: %f)\n", (int)(l + 1), (int)lod.triangle_count, error);
+        mesh.lod_count++;
+        source = &lod;
+    }
+}
+
+int obj2mesh(char* obj_file_path, char* mesh_file_path, bool invert_winding_order = false, f32 scale = 1, float rotY = 0, bool optimize_overdraw = false, u32 lod_count = 0) {
+    const u8 triangle_vertex_ids[3] = {0, (u8)(invert_winding_order ? 2 : 1), (u8)(invert_winding_order ? 1 : 2)};
 
     Mesh mesh;
     mesh.triangle_count = 0;
@@ -51,83 +458,43 @@ int obj2mesh(char* obj_file_path, char* mesh_file_path, bool invert_winding_orde
     mesh.vertex_uvs              = nullptr;
     mesh.vertex_uvs_indices      = nullptr;
 
-    FILE* obj_file;
-
-    obj_file = fopen(obj_file_path, "r");
-    char line[1024];
-
-    enum VertexAttributes vertex_attributes = VertexAttributes_None;
-    while (fgets(line, 1024, obj_file)) {
-        if (strncmp(line, (char*)"vn ", 2) == 0) mesh.normals_count++;
-        if (strncmp(line, (char*)"vt ", 2) == 0) mesh.uvs_count++;
-        if (strncmp(line, (char*)"v ", 2) == 0) mesh.vertex_count++;
-        if (strncmp(line, (char*)"f ", 2) == 0) {
-            mesh.triangle_count++;
-            if (vertex_attributes == VertexAttributes_None) {
-                int forward_slash_count = 0;
-                char *character = line;
-                while (*character) {
-                    if ((*character) == '/') forward_slash_count++;
-                    character++;
-                }
-                switch (forward_slash_count) {
-                    case 0: vertex_attributes = VertexAttributes_Positions; break;
-                    case 3: vertex_attributes = VertexAttributes_PositionsAndUVs; break;
-                    case 6: vertex_attributes = VertexAttributes_PositionsUVsAndNormals; break;
-                    default: break;
-                }
-            }
-
-            switch (vertex_attributes) {
-                case VertexAttributes_Positions:
-                    sscanf(
-                            line, (char*)"f %d %d %d",
-                            &vertex_indices[v1_id],
-                            &vertex_indices[v2_id],
-                            &vertex_indices[v3_id]
-                    );
-                    break;
-                case VertexAttributes_PositionsAndUVs:
-                    sscanf(
-                            line, (char*)"f %d/%d %d/%d %d/%d",
-                            &vertex_indices[v1_id], &uvs_indices[v1_id],
-                            &vertex_indices[v2_id], &uvs_indices[v2_id],
-                            &vertex_indices[v3_id], &uvs_indices[v3_id]
-                    );
-                    break;
-                case VertexAttributes_PositionsUVsAndNormals:
-                    sscanf(
-                            line, (char*)"f %d/%d/%d %d/%d/%d %d/%d/%d",
-                            &vertex_indices[v1_id], &uvs_indices[v1_id], &normal_indices[v1_id],
-                            &vertex_indices[v2_id], &uvs_indices[v2_id], &normal_indices[v2_id],
-                            &vertex_indices[v3_id], &uvs_indices[v3_id], &normal_indices[v3_id]
-                    );
-                    break;
-                default:
-                    return 1;
-            }
-
-            for (u8 i = 0; i < 3; i++) vertex_indices[i]--;
+    u64 file_size;
+    const char *obj_file = (const char*)os::mapFileForReading(obj_file_path, &file_size);
+    if (!obj_file) return 1;
+
+    const char *obj_file_end = obj_file + file_size;
+    const u32 chunk_count = (u32)((file_size + OBJ_CHUNK_SIZE - 1) / OBJ_CHUNK_SIZE);
+    OBJChunk *chunks = new OBJChunk[chunk_count];
+    for (u32 i = 0; i < chunk_count; i++) {
+        chunks[i].start = i ? chunks[i - 1].end : obj_file;
+        chunks[i].end = i == chunk_count - 1 ? obj_file_end : skipLine(obj_file + (u64)(i + 1) * OBJ_CHUNK_SIZE - 1, obj_file_end);
+        if (chunks[i].end < chunks[i].start) chunks[i].end = chunks[i].start;
+    }
 
-            u64 edge_hash1, edge_hash2;
-            for (u8 from = 0, to = 1; from < 3; from++, to = (to + 1) % 3) {
-                f = vertex_indices[from];
-                t = vertex_indices[to];
-                edge_hash1 = (u64)f + ((u64)t << 32);
-                edge_hash2 = (u64)t + ((u64)f << 32);
-                if (edge_hashes.find(edge_hash1) == edge_hashes.end() &&
-                    edge_hashes.find(edge_hash2) == edge_hashes.end()) {
-                    edge_hashes.insert(edge_hash1);
-                    mesh.edge_count++;
-                }
-            }
-        }
+    parallelFor(chunk_count, [&](u32 first_chunk, u32 end_chunk) {
+        for (u32 i = first_chunk; i < end_chunk; i++) countChunk(chunks[i]);
+    }, 1);
+
+    for (u32 i = 0; i < chunk_count; i++) {
+        OBJChunk &chunk = chunks[i];
+        u32 vertex_count = chunk.vertex_count;
+        u32 uvs_count = chunk.uvs_count;
+        u32 normals_count = chunk.normals_count;
+        u32 triangle_count = chunk.triangle_count;
+        chunk.vertex_count = mesh.vertex_count;
+        chunk.uvs_count = mesh.uvs_count;
+        chunk.normals_count = mesh.normals_count;
+        chunk.triangle_count = mesh.triangle_count;
+        mesh.vertex_count += vertex_count;
+        mesh.uvs_count += uvs_count;
+        mesh.normals_count += normals_count;
+        mesh.triangle_count += triangle_count;
     }
-    fclose(obj_file);
 
-    mesh.tangents_count = mesh.triangle_count * 3;
+    mesh.tangents_count = mesh.triangle_count * 3; // Room for a tangent per corner, until shared ones are merged (see generateTangents)
     mesh.bvh.node_count = mesh.triangle_count * 2;
     mesh.bvh.height = (u8)mesh.triangle_count;
+    mesh.edge_count = mesh.triangle_count * 3; // Room for every edge, until shared ones are merged (see extractEdges)
 
     u64 memory_capacity = getSizeInBytes(mesh);
     memory_capacity += BVHBuilder::getSizeInBytes(mesh.triangle_count * 2);
@@ -135,133 +502,32 @@ int obj2mesh(char* obj_file_path, char* mesh_file_path, bool invert_winding_orde
     allocateMemory(mesh, &memory_allocator);
     BVHBuilder builder{mesh.triangle_count * 2, &memory_allocator};
 
-    vec3 *vertex_position = mesh.vertex_positions;
-    vec3 *vertex_normal = mesh.vertex_normals;
-    vec2 *vertex_uvs = mesh.vertex_uvs;
-    TriangleVertexIndices *vertex_position_indices = mesh.vertex_position_indices;
-    TriangleVertexIndices *vertex_normal_indices = mesh.vertex_normal_indices;
-    TriangleVertexIndices *vertex_tangent_indices = mesh.vertex_tangent_indices;
-    TriangleVertexIndices *vertex_uvs_indices = mesh.vertex_uvs_indices;
-
-    obj_file = fopen(obj_file_path, (char*)"r");
-    while (fgets(line, 1024, obj_file)) {
-        // Vertex information
-        if (strncmp(line, (char*)"v ", 2) == 0) {
-            sscanf(line, (char*)"v %f %f %f", &vertex_position->x, &vertex_position->y, &vertex_position->z);
-            vertex_position++;
-        } else if (strncmp(line, (char*)"vn ", 2) == 0) {
-            sscanf(line, (char*)"vn %f %f %f", &vertex_normal->x, &vertex_normal->y, &vertex_normal->z);
-            vertex_normal++;
-        } else if (strncmp(line, (char*)"vt ", 2) == 0) {
-            sscanf(line, (char*)"vt %f %f", &vertex_uvs->x, &vertex_uvs->y);
-            vertex_uvs++;
-        } else if (strncmp(line, (char*)"f ", 2) == 0) {
-            switch (vertex_attributes) {
-                case VertexAttributes_Positions:
-                    sscanf(
-                            line, (char*)"f %d %d %d",
-                            &vertex_indices[v1_id],
-                            &vertex_indices[v2_id],
-                            &vertex_indices[v3_id]
-                    );
-                    break;
-                case VertexAttributes_PositionsAndUVs:
-                    sscanf(
-                            line, (char*)"f %d/%d %d/%d %d/%d",
-                            &vertex_indices[v1_id], &uvs_indices[v1_id],
-                            &vertex_indices[v2_id], &uvs_indices[v2_id],
-                            &vertex_indices[v3_id], &uvs_indices[v3_id]
-                    );
-                    vertex_uvs_indices->ids[0] = uvs_indices[0] - 1;
-                    vertex_uvs_indices->ids[1] = uvs_indices[1] - 1;
-                    vertex_uvs_indices->ids[2] = uvs_indices[2] - 1;
-                    vertex_uvs_indices++;
-                    break;
-                case VertexAttributes_PositionsUVsAndNormals:
-                    sscanf(
-                            line, (char*)"f %d/%d/%d %d/%d/%d %d/%d/%d",
-                            &vertex_indices[v1_id], &uvs_indices[v1_id], &normal_indices[v1_id],
-                            &vertex_indices[v2_id], &uvs_indices[v2_id], &normal_indices[v2_id],
-                            &vertex_indices[v3_id], &uvs_indices[v3_id], &normal_indices[v3_id]
-                    );
-                    vertex_uvs_indices->ids[0] = uvs_indices[0] - 1;
-                    vertex_uvs_indices->ids[1] = uvs_indices[1] - 1;
-                    vertex_uvs_indices->ids[2] = uvs_indices[2] - 1;
-                    vertex_normal_indices->ids[0] = normal_indices[0] - 1;
-                    vertex_normal_indices->ids[1] = normal_indices[1] - 1;
-                    vertex_normal_indices->ids[2] = normal_indices[2] - 1;
-                    vertex_normal_indices++;
-                    vertex_uvs_indices++;
-                    break;
-                default:
-                    return 1;
-            }
-            vertex_position_indices->ids[0] = vertex_indices[0] - 1;
-            vertex_position_indices->ids[1] = vertex_indices[1] - 1;
-            vertex_position_indices->ids[2] = vertex_indices[2] - 1;
-            vertex_position_indices++;
-        }
-    }
-    fclose(obj_file);
-
-    f = 0;
-    for (u64 edge_hash : edge_hashes) mesh.edge_vertex_indices[f++] = {(u32)edge_hash, (u32)(edge_hash >> 32)};
-
-    vec3 *tangent = mesh.vertex_tangents;
-    vec2 uv[3];
-    vec3 pos[3];
-    for (f = 0; f < mesh.triangle_count; f++) {
-        for (u8 i = 0; i < 3; i++) {
-            uv[i] = mesh.vertex_uvs[mesh.vertex_uvs_indices[f].ids[i]];
-            pos[i] = mesh.vertex_positions[mesh.vertex_position_indices[f].ids[i]];
-        }
-        for (u8 i = 0; i < 3; i++, tangent++) {
-            u8 i1 = i;
-            u8 i2 = (i + 1) % 3;
-            u8 i3 = (i + 2) % 3;
-            vec3 edge1 = pos[i2] - pos[i1];
-            vec3 edge2 = pos[i3] - pos[i1];
-            vec2 deltaUV1 = uv[i2] - uv[i1];
-            vec2 deltaUV2 = uv[i3] - uv[i1];
-
-            *tangent = vec3{
-                (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x),
-                (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y),
-                (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z)
-            } / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-            mesh.vertex_tangent_indices[f].ids[i] = f * 3 + i;
-        }
+    parallelFor(chunk_count, [&](u32 first_chunk, u32 end_chunk) {
+        for (u32 i = first_chunk; i < end_chunk; i++) parseChunk(chunks[i], mesh, triangle_vertex_ids);
+    }, 1);
+
+    delete[] chunks;
+    os::unmapFile((void*)obj_file);
+
+    // Reorder for the rasterizer before anything is derived from the order of triangles or vertices:
+    {
+        u32 *triangle_order = new u32[mesh.triangle_count];
+        f32 acmr = getACMR(mesh.vertex_position_indices, mesh.triangle_count, mesh.vertex_count);
+        optimizeVertexCache(mesh.vertex_position_indices, mesh.triangle_count, mesh.vertex_count, triangle_order);
+        if (optimize_overdraw) optimizeOverdraw(mesh, triangle_order);
+        reorderTriangles(mesh, triangle_order);
+        reorderVertices(mesh);
+        delete[] triangle_order;
+        printf("ACMR: %.3f -> %.3f\n", acmr, getACMR(mesh.vertex_position_indices, mesh.triangle_count, mesh.vertex_count));
     }
 
-    mat3 rot;
-    if (rotY) {
-        rot = mat3::RotationAroundY(rotY *  DEG_TO_RAD);
-        for (u32 i = 0; i < mesh.normals_count; i++) {
-            vec3 &normal = mesh.vertex_normals[i];
-            normal = rot * normal;
-        }
-    }
+    extractEdges(mesh);
 
-    mesh.aabb.min = INFINITY;
-    mesh.aabb.max = -INFINITY;
-    for (u32 i = 0; i < mesh.vertex_count; i++) {
-        vec3 &position = mesh.vertex_positions[i];
-        position *= scale;
-        if (rotY) position = rot * position;
-        mesh.aabb.min = minimum(mesh.aabb.min, position);
-        mesh.aabb.max = maximum(mesh.aabb.max, position);
-    }
-
-    vec3 centroid = (mesh.aabb.min + mesh.aabb.max) / 2.0f;
-    if (centroid.nonZero()) {
-        mesh.aabb.min -= centroid;
-        mesh.aabb.max -= centroid;
-        for (u32 i = 0; i < mesh.vertex_count; i++)
-            mesh.vertex_positions[i] -= centroid;
-    }
+    transformVertices(mesh, scale, rotY);
+    generateTangents(mesh);
 
     builder.buildMesh(mesh);
+    if (lod_count) generateLODs(mesh, lod_count, builder);
     save(mesh, mesh_file_path);
 
     return 0;
@@ -273,24 +539,32 @@ int main(int argc, char *argv[]) {
                        "An '.obj' file (input) then a '.mesh' file (output), "
                        "an optional flag '-invert_winding_order' for inverting winding order"
                        "an optional flag 'scale:<float>' for scaling the mesh,"
-                       "an optional flag 'rotY:<float> for rotating the mesh around Y"
+                       "an optional flag 'rotY:<float> for rotating the mesh around Y,"
+                       "an optional flag '-optimize_overdraw' for ordering triangles for less overdraw,"
+                       "an optional flag 'lods:<int>' for adding that many simplified LODs (each with half the triangles)"
                        ));
         return 0;
     } else if (argc == 3 || // 2 arguments
                argc == 4 || // 3 arguments
                argc == 5 || // 4 arguments
-               argc == 6    // 5 arguments
+               argc == 6 || // 5 arguments
+               argc == 7 || // 6 arguments
+               argc == 8    // 7 arguments
             ) {
         char *obj_file_path = argv[1];
         char *mesh_file_path = argv[2];
         if (argc == 3) return obj2mesh(obj_file_path, mesh_file_path);
 
         bool invert_winding_order = false;
+        bool optimize_overdraw = false;
         float scale{1}, rotY{0};
+        u32 lod_count = 0;
         for (u32 i = 3; i < (u32)argc; i++) {
             char *arg = argv[i];
             if (strcmp(arg, (char *) "-invert_winding_order") == 0)
                 invert_winding_order = true;
+            else if (strcmp(arg, (char *) "-optimize_overdraw") == 0)
+                optimize_overdraw = true;
             else {
                 char *scale_arg_prefix = (char *) "scale:";
                 bool is_scale_arg = true;
@@ -310,10 +584,12 @@ int main(int argc, char *argv[]) {
                             break;
                         }
                     if (is_rotY_arg) rotY = (f32)atof(arg + 5);
+                    else if (strncmp(arg, (char *) "lods:", 5) == 0)
+                        lod_count = Min((u32)atoi(arg + 5), (u32)MESH_MAX_LOD_COUNT);
                 }
             }
         }
-        return obj2mesh(obj_file_path, mesh_file_path, invert_winding_order, scale, rotY);
+        return obj2mesh(obj_file_path, mesh_file_path, invert_winding_order, scale, rotY, optimize_overdraw, lod_count);
     }
 
     printf((char*)("Exactly 2 file paths need to be provided: "
@@ -103,6 +103,12 @@
     #define signbit std::signbit
 #endif
 
+// SSE2 code paths are used on x86/x64 host code, unless SLIM_NO_SIMD is defined:
+#if !defined(SLIM_NO_SIMD) && !defined(__CUDACC__) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define SLIM_SIMD 1
+    #include <emmintrin.h>
+#endif
+
 //#define SLIM_EXPORT
 #ifdef SLIM_EXPORT
     #if defined(COMPILER_CLANG)
@@ -1338,6 +1344,13 @@ struct TiledGridInfo {
     }
 };
 
+enum ImageCompression {
+    ImageCompression_None = 0,
+    ImageCompression_BC1, // RGB565 endpoints, 2-bit indices (albedo)
+    ImageCompression_BC4, // One 8-bit channel, 3-bit indices
+    ImageCompression_BC5  // Two BC4 channels (normal XY)
+};
+
 union ImageFlags {
     struct {
         unsigned int alpha:1;
@@ -1349,6 +1362,8 @@ union ImageFlags {
         unsigned int wrap:1;
         unsigned int normal:1;
         unsigned int cubemap:1;
+        unsigned int apron:1;
+        unsigned int compression:2; // ImageCompression
     };
     u32 flags = 0;
 };
@@ -1458,6 +1473,9 @@ namespace controls {
 namespace os {
     void* getMemory(u64 size, u64 base = 0);
     void freeMemory(void* memory);
+    void* reserveMemory(u64 size);
+    bool commitMemory(void* memory, u64 size);
+    void decommitMemory(void* memory, u64 size);
     void setWindowTitle(char* str);
     void setWindowCapture(bool on);
     void setCursorVisibility(bool on);
@@ -1466,11 +1484,15 @@ namespace os {
     void* openFileForWriting(const char* file_path);
     bool readFromFile(void *out, unsigned long, void *handle);
     bool writeToFile(void *out, unsigned long, void *handle);
+    bool setFilePosition(void *handle, u64 position);
     void print(const char *message, u8 color);
     void printError(const char *message, u8 color);
     long long int getFileSizeWithoutOpening(const char* path);
     long long int getFileSize(void *handle);
     void* readEntireFile(const char* file_path, u64 *out_size);
+    void* mapFileForReading(const char* file_path, u64 *out_size);
+    void unmapFile(void *memory);
+    i32 runProcess(char *command_line);
 }
 
 namespace timers {
@@ -1642,6 +1664,11 @@ namespace memory {
             return current_address;
         }
 
+        void reset() {
+            address -= occupied;
+            occupied = 0;
+        }
+
         void releaseMemory() {
             address -= occupied;
             os::freeMemory(address);
@@ -1656,13 +1683,32 @@ namespace window {
     u16 height{DEFAULT_HEIGHT};
     char* title{(char*)""};
     u32 *content{nullptr};
+
+    // Regions of content that changed since the last present (nullptr means all of it):
+    RectI *dirty_rects{nullptr};
+    u8 dirty_rects_count{0};
 }
 
+// Field by field, so the layout in files does not depend on the struct's (padding, or the methods it inherits):
 void writeHeader(const ImageInfo &info, void *file) {
-    os::writeToFile((void*)&info,  sizeof(info),  file);
+    os::writeToFile((void*)&info.width,       sizeof(u32), file);
+    os::writeToFile((void*)&info.height,      sizeof(u32), file);
+    os::writeToFile((void*)&info.size,        sizeof(u32), file);
+    os::writeToFile((void*)&info.stride,      sizeof(u32), file);
+    os::writeToFile((void*)&info.tile_width,  sizeof(u32), file);
+    os::writeToFile((void*)&info.tile_height, sizeof(u32), file);
+    os::writeToFile((void*)&info.mip_count,   sizeof(u32), file);
+    os::writeToFile((void*)&info.flags.flags, sizeof(u32), file);
 }
 void readHeader(ImageInfo &info, void *file) {
-    os::readFromFile(&info,  sizeof(info),  file);
+    os::readFromFile(&info.width,       sizeof(u32), file);
+    os::readFromFile(&info.height,      sizeof(u32), file);
+    os::readFromFile(&info.size,        sizeof(u32), file);
+    os::readFromFile(&info.stride,      sizeof(u32), file);
+    os::readFromFile(&info.tile_width,  sizeof(u32), file);
+    os::readFromFile(&info.tile_height, sizeof(u32), file);
+    os::readFromFile(&info.mip_count,   sizeof(u32), file);
+    os::readFromFile(&info.flags.flags, sizeof(u32), file);
 }
 
 template <typename T>
@@ -0,0 +1,351 @@
+#pragma once
+
+#include "./base.h"
+
+// Block compressed images store every 4x4 texels in a fixed size block (8 bytes for BC1/BC4, 16 for BC5),
+// with a full chain of mips (down to 1x1) one after the other, as GPUs can not generate mips for them.
+// Texels within a block are row-major, and so are blocks within a mip.
+
+INLINE u32 getCompressedBlockSize(ImageCompression compression) {
+    return compression == ImageCompression_BC5 ? 16 : 8;
+}
+
+INLINE u32 getCompressedMipSize(u32 width, u32 height, ImageCompression compression) {
+    return ((width + 3) / 4) * ((height + 3) / 4) * getCompressedBlockSize(compression);
+}
+
+INLINE u32 getCompressedMipCount(u32 width, u32 height) {
+    u32 mip_count = 1;
+    while (width > 1 || height > 1) {
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        mip_count++;
+    }
+    return mip_count;
+}
+
+u32 getCompressedSize(const ImageInfo &info) {
+    ImageCompression compression = (ImageCompression)info.flags.compression;
+    u32 mip_count = info.mip_count ? info.mip_count : 1;
+    u32 width = info.width;
+    u32 height = info.height;
+    u32 size = 0;
+    for (u32 mip = 0; mip < mip_count; mip++) {
+        size += getCompressedMipSize(width, height, compression);
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+}
+
+INLINE u16 packRGB565(const f32 *rgb) {
+    u16 r = (u16)Min(31.0f, Max(0.0f, rgb[0] * (31.0f / 255.0f) + 0.5f));
+    u16 g = (u16)Min(63.0f, Max(0.0f, rgb[1] * (63.0f / 255.0f) + 0.5f));
+    u16 b = (u16)Min(31.0f, Max(0.0f, rgb[2] * (31.0f / 255.0f) + 0.5f));
+    return (u16)((r << 11) | (g << 5) | b);
+}
+
+INLINE void unpackRGB565(u16 color, u8 *rgb) {
+    u8 r = (u8)((color >> 11) & 31);
+    u8 g = (u8)((color >> 5) & 63);
+    u8 b = (u8)(color & 31);
+    rgb[0] = (u8)((r << 3) | (r >> 2));
+    rgb[1] = (u8)((g << 2) | (g >> 4));
+    rgb[2] = (u8)((b << 3) | (b >> 2));
+}
+
+// Endpoints are the extremes of the block's colors along their principal axis (found by power iteration
+// on the covariance matrix), and every texel gets the index of the nearest of the 4 palette colors:
+void encodeBC1Block(const u8 *rgb, u8 *block) {
+    f32 mean[3]{0, 0, 0};
+    for (u32 i = 0; i < 16; i++)
+        for (u32 c = 0; c < 3; c++)
+            mean[c] += (f32)rgb[i * 3 + c];
+    for (u32 c = 0; c < 3; c++) mean[c] *= 1.0f / 16.0f;
+
+    f32 covariance[6]{0, 0, 0, 0, 0, 0};
+    for (u32 i = 0; i < 16; i++) {
+        f32 r = (f32)rgb[i * 3 + 0] - mean[0];
+        f32 g = (f32)rgb[i * 3 + 1] - mean[1];
+        f32 b = (f32)rgb[i * 3 + 2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    f32 axis[3]{1, 1, 1};
+    for (u32 iteration = 0; iteration < 8; iteration++) {
+        f32 x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        f32 y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        f32 z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        f32 length = Max(Max(fabsf(x), fabsf(y)), fabsf(z));
+        if (length == 0) break;
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+    f32 axis_length_squared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    if (axis_length_squared > 0) {
+        f32 axis_length_rcp = 1.0f / sqrtf(axis_length_squared);
+        for (u32 c = 0; c < 3; c++) axis[c] *= axis_length_rcp;
+    }
+
+    f32 min_t = 0, max_t = 0;
+    for (u32 i = 0; i < 16; i++) {
+        f32 t = ((f32)rgb[i * 3 + 0] - mean[0]) * axis[0] +
+                ((f32)rgb[i * 3 + 1] - mean[1]) * axis[1] +
+                ((f32)rgb[i * 3 + 2] - mean[2]) * axis[2];
+        if (t < min_t) min_t = t;
+        if (t > max_t) max_t = t;
+    }
+    f32 max_color[3], min_color[3];
+    for (u32 c = 0; c < 3; c++) {
+        max_color[c] = mean[c] + axis[c] * max_t;
+        min_color[c] = mean[c] + axis[c] * min_t;
+    }
+
+    u16 color0 = packRGB565(max_color);
+    u16 color1 = packRGB565(min_color);
+    u32 indices = 0;
+    if (color0 != color1) {
+        // The 4-color mode needs color0 > color1:
+        if (color0 < color1) {
+            u16 swapped = color0;
+            color0 = color1;
+            color1 = swapped;
+        }
+
+        u8 palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (u32 c = 0; c < 3; c++) {
+            palette[2][c] = (u8)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+            palette[3][c] = (u8)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+        }
+
+        for (u32 i = 0; i < 16; i++) {
+            u32 best_index = 0;
+            i32 best_distance = 0x7FFFFFFF;
+            for (u32 p = 0; p < 4; p++) {
+                i32 r = (i32)rgb[i * 3 + 0] - (i32)palette[p][0];
+                i32 g = (i32)rgb[i * 3 + 1] - (i32)palette[p][1];
+                i32 b = (i32)rgb[i * 3 + 2] - (i32)palette[p][2];
+                i32 distance = r * r + g * g + b * b;
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_index = p;
+                }
+            }
+            indices |= best_index << (i * 2);
+        }
+    }
+
+    block[0] = (u8)(color0 & 0xFF);
+    block[1] = (u8)(color0 >> 8);
+    block[2] = (u8)(color1 & 0xFF);
+    block[3] = (u8)(color1 >> 8);
+    for (u32 i = 0; i < 4; i++) block[4 + i] = (u8)((indices >> (i * 8)) & 0xFF);
+}
+
+void decodeBC1Block(const u8 *block, u8 *rgba) {
+    u16 color0 = (u16)(block[0] | (block[1] << 8));
+    u16 color1 = (u16)(block[2] | (block[3] << 8));
+    u8 palette[4][4];
+    unpackRGB565(color0, palette[0]);
+    unpackRGB565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    for (u32 c = 0; c < 3; c++) {
+        if (color0 > color1) {
+            palette[2][c] = (u8)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+            palette[3][c] = (u8)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+        } else {
+            palette[2][c] = (u8)((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    if (color0 <= color1) palette[3][3] = 0;
+
+    u32 indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((u32)block[7] << 24);
+    for (u32 i = 0; i < 16; i++) {
+        const u8 *color = palette[(indices >> (i * 2)) & 3];
+        for (u32 c = 0; c < 4; c++) rgba[i * 4 + c] = color[c];
+    }
+}
+
+// Values are taken from every stride'th byte. Uses the 8-value mode (endpoint0 > endpoint1)
+// with the block's maximum and minimum as endpoints:
+void encodeBC4Block(const u8 *values, u32 stride, u8 *block) {
+    u8 max_value = 0, min_value = 255;
+    for (u32 i = 0; i < 16; i++) {
+        u8 value = values[i * stride];
+        if (value > max_value) max_value = value;
+        if (value < min_value) min_value = value;
+    }
+
+    block[0] = max_value;
+    block[1] = min_value;
+    u64 indices = 0;
+    if (max_value != min_value) {
+        f32 range = (f32)(max_value - min_value);
+        for (u32 i = 0; i < 16; i++) {
+            // Position along the palette (0 at max_value, 7 at min_value), mapped to the index order
+            // of the 8-value mode (0: endpoint0, 1: endpoint1, 2..7: interpolated from endpoint0 on):
+            u64 position = (u64)((f32)(max_value - values[i * stride]) * 7.0f / range + 0.5f);
+            u64 index = position == 0 ? 0 : (position == 7 ? 1 : position + 1);
+            indices |= index << (i * 3);
+        }
+    }
+    for (u32 i = 0; i < 6; i++) block[2 + i] = (u8)((indices >> (i * 8)) & 0xFF);
+}
+
+// Decoded values go to every stride'th byte:
+void decodeBC4Block(const u8 *block, u8 *values, u32 stride) {
+    u32 endpoint0 = block[0];
+    u32 endpoint1 = block[1];
+    u8 palette[8];
+    palette[0] = (u8)endpoint0;
+    palette[1] = (u8)endpoint1;
+    if (endpoint0 > endpoint1) {
+        for (u32 i = 2; i < 8; i++)
+            palette[i] = (u8)(((8 - i) * endpoint0 + (i - 1) * endpoint1 + 3) / 7);
+    } else {
+        for (u32 i = 2; i < 6; i++)
+            palette[i] = (u8)(((6 - i) * endpoint0 + (i - 1) * endpoint1 + 2) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    u64 indices = 0;
+    for (u32 i = 0; i < 6; i++) indices |= (u64)block[2 + i] << (i * 8);
+    for (u32 i = 0; i < 16; i++)
+        values[i * stride] = palette[(indices >> (i * 3)) & 7];
+}
+
+// Components are RGB(A) ordered, as the GL uploads them. BC4 keeps the red channel and BC5 the red and green
+// channels (the X and Y of normal maps). Blocks past the right/bottom edges repeat the edge texels:
+void compressMip(const u8 *components, u32 width, u32 height, u32 component_count, ImageCompression compression, u8 *blocks) {
+    u8 block_texels[16 * 3];
+    u32 block_size = getCompressedBlockSize(compression);
+    for (u32 block_y = 0; block_y < height; block_y += 4) {
+        for (u32 block_x = 0; block_x < width; block_x += 4, blocks += block_size) {
+            for (u32 y = 0; y < 4; y++) {
+                u32 Y = Min(block_y + y, height - 1);
+                for (u32 x = 0; x < 4; x++) {
+                    u32 X = Min(block_x + x, width - 1);
+                    const u8 *component = components + (Y * width + X) * component_count;
+                    u8 *texel = block_texels + (y * 4 + x) * 3;
+                    texel[0] = component[0];
+                    texel[1] = component[component_count > 1 ? 1 : 0];
+                    texel[2] = component[component_count > 2 ? 2 : 0];
+                }
+            }
+
+            switch (compression) {
+                case ImageCompression_BC1: encodeBC1Block(block_texels, blocks); break;
+                case ImageCompression_BC4: encodeBC4Block(block_texels, 3, blocks); break;
+                case ImageCompression_BC5:
+                    encodeBC4Block(block_texels,     3, blocks);
+                    encodeBC4Block(block_texels + 1, 3, blocks + 8);
+                    break;
+                default: break;
+            }
+        }
+    }
+}
+
+INLINE void setCompression(ImageInfo &info, ImageCompression compression) {
+    info.flags.compression = compression;
+    info.flags.mipmap = true;
+    info.mip_count = getCompressedMipCount(info.width, info.height);
+}
+
+// Compresses the image and all its mips (box-filtered from the previous one) into blocks, which must have
+// getCompressedSize() bytes (with the info already set up for the compression by setCompression()):
+void compressImage(const u8 *components, const ImageInfo &info, u8 *blocks) {
+    ImageCompression compression = (ImageCompression)info.flags.compression;
+    u32 component_count = info.flags.alpha ? 4 : 3;
+    u32 width = info.width;
+    u32 height = info.height;
+
+    u8 *mip_components = new u8[width * height * component_count];
+    u8 *next_mip_components = new u8[width * height * component_count];
+    for (u32 i = 0; i < width * height * component_count; i++) mip_components[i] = components[i];
+
+    for (u32 mip = 0; mip < info.mip_count; mip++) {
+        compressMip(mip_components, width, height, component_count, compression, blocks);
+        blocks += getCompressedMipSize(width, height, compression);
+        if (mip + 1 == info.mip_count) break;
+
+        u32 next_width  = width  > 1 ? width  / 2 : 1;
+        u32 next_height = height > 1 ? height / 2 : 1;
+        u8 *next_component = next_mip_components;
+        for (u32 y = 0; y < next_height; y++) {
+            u32 top = Min(y * 2, height - 1);
+            u32 bottom = Min(y * 2 + 1, height - 1);
+            for (u32 x = 0; x < next_width; x++) {
+                u32 left = Min(x * 2, width - 1);
+                u32 right = Min(x * 2 + 1, width - 1);
+                for (u32 c = 0; c < component_count; c++)
+                    *(next_component++) = (u8)((
+                        mip_components[(top    * width + left ) * component_count + c] +
+                        mip_components[(top    * width + right) * component_count + c] +
+                        mip_components[(bottom * width + left ) * component_count + c] +
+                        mip_components[(bottom * width + right) * component_count + c] + 2) / 4);
+            }
+        }
+
+        u8 *swapped = mip_components;
+        mip_components = next_mip_components;
+        next_mip_components = swapped;
+        width = next_width;
+        height = next_height;
+    }
+
+    delete[] mip_components;
+    delete[] next_mip_components;
+}
+
+// Decodes a mip of a compressed image into RGBA components (4 per texel), for the software renderers.
+// BC5 normal maps get their Z reconstructed from X and Y, other BC4/BC5 channels are left at 0:
+void decompressMip(const u8 *blocks, const ImageInfo &info, u32 mip, u8 *components) {
+    ImageCompression compression = (ImageCompression)info.flags.compression;
+    u32 width = info.width;
+    u32 height = info.height;
+    for (u32 i = 0; i < mip; i++) {
+        blocks += getCompressedMipSize(width, height, compression);
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    u8 block_texels[16 * 4];
+    u32 block_size = getCompressedBlockSize(compression);
+    for (u32 block_y = 0; block_y < height; block_y += 4) {
+        for (u32 block_x = 0; block_x < width; block_x += 4, blocks += block_size) {
+            for (u32 i = 0; i < 16 * 4; i++) block_texels[i] = i % 4 == 3 ? 255 : 0;
+            switch (compression) {
+                case ImageCompression_BC1: decodeBC1Block(blocks, block_texels); break;
+                case ImageCompression_BC4: decodeBC4Block(blocks, block_texels, 4); break;
+                case ImageCompression_BC5:
+                    decodeBC4Block(blocks,     block_texels,     4);
+                    decodeBC4Block(blocks + 8, block_texels + 1, 4);
+                    if (info.flags.normal)
+                        for (u32 i = 0; i < 16; i++) {
+                            f32 x = (f32)block_texels[i * 4 + 0] * (2.0f / 255.0f) - 1.0f;
+                            f32 y = (f32)block_texels[i * 4 + 1] * (2.0f / 255.0f) - 1.0f;
+                            f32 z = sqrtf(Max(0.0f, 1.0f - x * x - y * y));
+                            block_texels[i * 4 + 2] = (u8)(z * 127.5f + 127.5f);
+                        }
+                    break;
+                default: break;
+            }
+
+            for (u32 y = 0; y < 4 && block_y + y < height; y++)
+                for (u32 x = 0; x < 4 && block_x + x < width; x++)
+                    for (u32 c = 0; c < 4; c++)
+                        components[((block_y + y) * width + block_x + x) * 4 + c] = block_texels[(y * 4 + x) * 4 + c];
+        }
+    }
+}
@@ -53,10 +53,12 @@ struct HUDSettings {
     u32 line_count = 0;
     f32 line_height = 1.2f;
     enum ColorID default_color = BrightGrey;
+    bool cache_text = false; // Draw titles and alternate values (which don't change) through the text cache
 
     HUDSettings(u32 line_count = 0,
                 f32 line_height = 1.2f,
-                ColorID default_color = BrightGrey) : line_count{line_count}, line_height{line_height}, default_color{default_color} {}
+                ColorID default_color = BrightGrey,
+                bool cache_text = false) : line_count{line_count}, line_height{line_height}, default_color{default_color}, cache_text{cache_text} {}
 };
 struct HUD {
     HUDSettings settings;
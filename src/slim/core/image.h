@@ -1,6 +1,7 @@
 #pragma once
 
 #include "./base.h"
+#include "./block_compression.h"
 
 
 u8* componentsToByteColor(u8 *component, ByteColor &byte_color, ImageInfo &info) {
@@ -36,44 +37,73 @@ u8* componentsToPixel(u8 *component, Pixel *pixel, ImageInfo &info, f32 gamma =
     return component;
 }
 
-void componentsToPixels(u8 *components, ImageInfo &info, Pixel *pixels, f32 gamma = 2.2f) {
-    Pixel* pixel = pixels;
-    u8 *component = components;
-    u32 count = info.width * info.height;
-    for (u32 i = 0; i < count; i++, pixel++)
-        component = componentsToPixel(component, pixel, info, gamma);
-}
-
-void componentsToByteColors(u8 *components, ImageInfo &info, ByteColor *byte_colors, f32 gamma = 2.2f) {
-    ByteColor* byte_color = byte_colors;
-    u8 *component = components;
-    u32 count = info.size;
-    Pixel pixel;
-    if (info.flags.linear && !info.flags.normal)
-        for (u32 i = 0; i < count; i++, byte_color++)
-            component = componentsToByteColor(component, *byte_color, info);
-    else
-        for (u32 i = 0; i < count; i++, byte_color++) {
-            component = componentsToPixel(component, &pixel, info, gamma);
-            *byte_color = pixel.color.toByteColor();
+// Converting whole images (see image_conversion.h) goes through per-image lookup tables (so gamma costs a load
+// instead of a powf per component) and renormalizes normal maps 4 pixels at a time:
+struct ComponentLUT {
+    f32 floats[256]; // Gamma corrected (unless linear) components as floats
+    u8 bytes[256];   // Gamma corrected (unless linear) components as bytes, as Color::toByteColor would make them
+
+    ComponentLUT(bool linear, f32 gamma = 2.2f) {
+        for (u32 i = 0; i < 256; i++) {
+            f32 value = (f32)i * COLOR_COMPONENT_TO_FLOAT;
+            floats[i] = linear ? value : powf(value, gamma);
+            bytes[i] = (u8)(floats[i] * FLOAT_TO_COLOR_COMPONENT);
         }
-}
+    }
+};
+
+void componentsToPixels(const u8 *component, const ImageInfo &info, Pixel *pixel, u32 count, const ComponentLUT &lut, f32 gamma = 2.2f) {
+    const u32 component_count = info.flags.alpha ? 4 : 3;
+    if (!info.flags.normal) {
+        for (u32 i = 0; i < count; i++, pixel++, component += component_count) {
+            pixel->color.blue  = lut.floats[component[0]];
+            pixel->color.green = lut.floats[component[1]];
+            pixel->color.red   = lut.floats[component[2]];
+            pixel->opacity = info.flags.alpha ? (f32)component[3] * COLOR_COMPONENT_TO_FLOAT : 0.0f;
+        }
+        return;
+    }
 
-void componentsToChannels(u8 *components, ImageInfo &info, f32 *channels, f32 gamma = 2.2f) {
-    f32* channel = channels;
-    u8 *component = components;
-    u32 component_count = info.flags.alpha ? 4 : 3;
-    u32 count = component_count * info.size;
-    Pixel pixel;
-    for (u32 i = 0; i < count; i++) {
-        component = componentsToPixel(component, &pixel, info, gamma);
-
-        *(channel++) = pixel.color.red;
-        *(channel++) = pixel.color.green;
-        *(channel++) = pixel.color.blue;
-        if (info.flags.alpha)
-            *(channel++) = pixel.opacity;
+    Pixel *first_pixel = pixel;
+    u32 i = 0;
+#ifdef SLIM_SIMD
+    const __m128 one  = _mm_set1_ps(1.0f);
+    const __m128 two  = _mm_set1_ps(2.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 to_float = _mm_set1_ps(COLOR_COMPONENT_TO_FLOAT);
+    const u8 *c0, *c1, *c2, *c3;
+    for (; i + 4 <= count; i += 4, pixel += 4, component += component_count * 4) {
+        c0 = component;
+        c1 = c0 + component_count;
+        c2 = c1 + component_count;
+        c3 = c2 + component_count;
+        __m128 r = _mm_mul_ps(_mm_set_ps((f32)c3[2], (f32)c2[2], (f32)c1[2], (f32)c0[2]), to_float);
+        __m128 g = _mm_mul_ps(_mm_set_ps((f32)c3[1], (f32)c2[1], (f32)c1[1], (f32)c0[1]), to_float);
+        __m128 a = info.flags.alpha ? _mm_mul_ps(_mm_set_ps((f32)c3[3], (f32)c2[3], (f32)c1[3], (f32)c0[3]), to_float) : _mm_setzero_ps();
+        r = _mm_sub_ps(_mm_mul_ps(r, two), one);
+        g = _mm_sub_ps(_mm_mul_ps(g, two), one);
+        __m128 l_rcp = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(g, g)), one)));
+        r = _mm_mul_ps(r, l_rcp);
+        g = _mm_mul_ps(g, l_rcp);
+        __m128 b = _mm_sqrt_ps(_mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(r, r)), _mm_mul_ps(g, g)));
+        r = _mm_add_ps(_mm_mul_ps(r, half), half);
+        g = _mm_add_ps(_mm_mul_ps(g, half), half);
+        b = _mm_add_ps(_mm_mul_ps(b, half), half);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        _mm_storeu_ps((f32*)(pixel + 0), r);
+        _mm_storeu_ps((f32*)(pixel + 1), g);
+        _mm_storeu_ps((f32*)(pixel + 2), b);
+        _mm_storeu_ps((f32*)(pixel + 3), a);
     }
+#endif
+    ImageInfo linear_info{info};
+    linear_info.flags.linear = true;
+    for (; i < count; i++, pixel++)
+        component = componentsToPixel((u8*)component, pixel, linear_info);
+
+    if (!info.flags.linear)
+        for (pixel = first_pixel, i = 0; i < count; i++, pixel++)
+            pixel->color.applyGamma(gamma);
 }
 
 void flipImage(const u8 *components, ImageInfo &info, u8 *flipped) {
@@ -93,6 +123,24 @@ void flipImage(const u8 *components, ImageInfo &info, u8 *flipped) {
     }
 }
 
+// Packs the 6 faces of a cube map (each oriented as a GL cube map face, with row 0 at t = 0) into the
+// horizontal strip that texture cube maps are built from: [-X, +Z, +X, -Z, +Y, -Y] (see Texture::sampleCube)
+void packCubeMapFaces(const CubeMapImages &faces, u8 *components) {
+    const RawImage *strip_faces[6] = {
+        &faces.neg_x, &faces.pos_z, &faces.pos_x, &faces.neg_z, &faces.pos_y, &faces.neg_y
+    };
+    u32 component_count = faces.pos_x.flags.alpha ? 4 : 3;
+    u32 face_stride = component_count * faces.pos_x.width;
+    u32 strip_stride = face_stride * 6;
+    for (u32 f = 0; f < 6; f++) {
+        const u8 *face_row = strip_faces[f]->content;
+        u8 *strip_row = components + face_stride * f;
+        for (u32 y = 0; y < faces.pos_x.height; y++, face_row += face_stride, strip_row += strip_stride)
+            for (u32 i = 0; i < face_stride; i++)
+                strip_row[i] = face_row[i];
+    }
+}
+
 void tileImage(u8 *components, ImageInfo &image_info, u8 *tiled) {
     u32 component_count = image_info.flags.alpha ? 4 : 3;
     u8 *component, *tiled_component = tiled;
@@ -121,4 +169,61 @@ void tileImage(u8 *components, ImageInfo &image_info, u8 *tiled) {
         }
         Y += image_info.tile_height;
     }
-}
\ No newline at end of file
+}
+
+// Bilinearly resamples RGBA components (texel centers aligned, edges clamped):
+void resampleComponents(const u8 *components, u32 width, u32 height, u32 new_width, u32 new_height, u8 *resampled) {
+    const f32 x_scale = (f32)width  / (f32)new_width;
+    const f32 y_scale = (f32)height / (f32)new_height;
+    for (u32 y = 0; y < new_height; y++) {
+        f32 Y = clampedValue(((f32)y + 0.5f) * y_scale - 0.5f, 0.0f, (f32)(height - 1));
+        u32 top = (u32)Y;
+        u32 bottom = Min(top + 1, height - 1);
+        f32 b = Y - (f32)top;
+        for (u32 x = 0; x < new_width; x++, resampled += 4) {
+            f32 X = clampedValue(((f32)x + 0.5f) * x_scale - 0.5f, 0.0f, (f32)(width - 1));
+            u32 left = (u32)X;
+            u32 right = Min(left + 1, width - 1);
+            f32 r = X - (f32)left;
+            const u8 *TL = components + (top    * width + left ) * 4;
+            const u8 *TR = components + (top    * width + right) * 4;
+            const u8 *BL = components + (bottom * width + left ) * 4;
+            const u8 *BR = components + (bottom * width + right) * 4;
+            for (u32 c = 0; c < 4; c++) {
+                f32 top_value    = (f32)TL[c] + ((f32)TR[c] - (f32)TL[c]) * r;
+                f32 bottom_value = (f32)BL[c] + ((f32)BR[c] - (f32)BL[c]) * r;
+                resampled[c] = (u8)(top_value + (bottom_value - top_value) * b + 0.5f);
+            }
+        }
+    }
+}
+
+// Packs images into equally sized RGBA layers (e.g. for texture arrays): Compressed images are decoded, and
+// images of other dimensions are resampled. Layers takes width * height * 4 bytes per image:
+void packImageLayers(const RawImage *const *images, u32 count, u32 width, u32 height, u8 *layers) {
+    u32 max_size = 0;
+    for (u32 i = 0; i < count; i++) max_size = Max(max_size, images[i]->width * images[i]->height);
+    u8 *rgba = new u8[max_size * 4];
+
+    u8 *layer = layers;
+    for (u32 i = 0; i < count; i++, layer += width * height * 4) {
+        const RawImage &image = *images[i];
+        bool same_size = image.width == width && image.height == height;
+        u8 *target = same_size ? layer : rgba;
+        if (image.flags.compression)
+            decompressMip(image.content, image, 0, target);
+        else {
+            const u8 *component = image.content;
+            u8 *texel = target;
+            for (u32 t = 0; t < image.width * image.height; t++, texel += 4) {
+                texel[0] = *(component++);
+                texel[1] = *(component++);
+                texel[2] = *(component++);
+                texel[3] = image.flags.alpha ? *(component++) : 255;
+            }
+        }
+        if (!same_size) resampleComponents(rgba, image.width, image.height, width, height, layer);
+    }
+
+    delete[] rgba;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "./image.h"
+#include "./parallel.h"
+
+// Whole-image conversions for the offline tools, with the rows split across threads (see parallelFor):
+#define IMAGE_CONVERSION_MIN_ROWS 32
+
+void componentsToPixels(u8 *components, ImageInfo &info, Pixel *pixels, f32 gamma = 2.2f) {
+    const ComponentLUT lut{info.flags.linear, gamma};
+    const u32 component_stride = (info.flags.alpha ? 4 : 3) * info.width;
+    parallelFor(info.height, [&](u32 first_row, u32 end_row) {
+        for (u32 y = first_row; y < end_row; y++)
+            componentsToPixels(components + y * component_stride, info, pixels + y * info.width, info.width, lut, gamma);
+    }, IMAGE_CONVERSION_MIN_ROWS);
+}
+
+void componentsToByteColors(u8 *components, ImageInfo &info, ByteColor *byte_colors, f32 gamma = 2.2f) {
+    const ComponentLUT lut{info.flags.linear, gamma};
+    const u32 component_count = info.flags.alpha ? 4 : 3;
+    const u32 component_stride = component_count * info.width;
+    const bool linear = info.flags.linear && !info.flags.normal;
+    parallelFor(info.height, [&](u32 first_row, u32 end_row) {
+        Pixel row_pixels[256];
+        for (u32 y = first_row; y < end_row; y++) {
+            const u8 *component = components + y * component_stride;
+            ByteColor *byte_color = byte_colors + y * info.width;
+            if (linear) {
+                for (u32 x = 0; x < info.width; x++, byte_color++)
+                    component = componentsToByteColor((u8*)component, *byte_color, info);
+            } else if (!info.flags.normal) {
+                for (u32 x = 0; x < info.width; x++, byte_color++, component += component_count)
+                    *byte_color = ByteColor{lut.bytes[component[2]], lut.bytes[component[1]], lut.bytes[component[0]], MAX_COLOR_VALUE};
+            } else {
+                for (u32 x = 0; x < info.width; x += 256, component += component_count * 256) {
+                    const u32 count = Min(info.width - x, 256u);
+                    componentsToPixels(component, info, row_pixels, count, lut, gamma);
+                    for (u32 i = 0; i < count; i++, byte_color++)
+                        *byte_color = row_pixels[i].color.toByteColor();
+                }
+            }
+        }
+    }, IMAGE_CONVERSION_MIN_ROWS);
+}
+
+void componentsToChannels(u8 *components, ImageInfo &info, f32 *channels, f32 gamma = 2.2f) {
+    const ComponentLUT lut{info.flags.linear, gamma};
+    const u32 component_count = info.flags.alpha ? 4 : 3;
+    const u32 component_stride = component_count * info.width;
+    parallelFor(info.height, [&](u32 first_row, u32 end_row) {
+        Pixel row_pixels[256];
+        for (u32 y = first_row; y < end_row; y++) {
+            const u8 *component = components + y * component_stride;
+            f32 *channel = channels + y * component_stride;
+            for (u32 x = 0; x < info.width; x += 256, component += component_count * 256) {
+                const u32 count = Min(info.width - x, 256u);
+                componentsToPixels(component, info, row_pixels, count, lut, gamma);
+                for (u32 i = 0; i < count; i++) {
+                    *(channel++) = row_pixels[i].color.red;
+                    *(channel++) = row_pixels[i].color.green;
+                    *(channel++) = row_pixels[i].color.blue;
+                    if (info.flags.alpha)
+                        *(channel++) = row_pixels[i].opacity;
+                }
+            }
+        }
+    }, IMAGE_CONVERSION_MIN_ROWS);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+
+#include "./base.h"
+
+#define PARALLEL_MAX_THREAD_COUNT 64
+
+// Splits [0, count) into contiguous ranges and calls body(first, end) for each on its own thread
+// (the calling thread takes the last range). Meant for offline tools: Ranges never get smaller than
+// min_range_size and small counts run inline. Writes from different ranges must not overlap:
+template <typename Body>
+void parallelFor(u32 count, Body &&body, u32 min_range_size = 16) {
+    u32 thread_count = (u32)std::thread::hardware_concurrency();
+    thread_count = Min(thread_count, (u32)PARALLEL_MAX_THREAD_COUNT);
+    thread_count = Min(thread_count, (count + min_range_size - 1) / min_range_size);
+    if (thread_count <= 1) {
+        body((u32)0, count);
+        return;
+    }
+
+    std::thread threads[PARALLEL_MAX_THREAD_COUNT];
+    const u32 range_size = (count + thread_count - 1) / thread_count;
+    u32 first = 0;
+    u32 thread_index = 0;
+    for (; first + range_size < count; first += range_size, thread_index++)
+        threads[thread_index] = std::thread(body, first, first + range_size);
+
+    body(first, count);
+    for (u32 i = 0; i < thread_index; i++) threads[i].join();
+}
+
+// Calls body(index) for every index in [0, count) from up to thread_count threads (0 for one per core), each
+// taking the next unclaimed index when done with its last one. For items of very uneven cost (like whole files):
+template <typename Body>
+void parallelForEach(u32 count, Body &&body, u32 thread_count = 0) {
+    if (!thread_count) thread_count = (u32)std::thread::hardware_concurrency();
+    thread_count = Min(thread_count, (u32)PARALLEL_MAX_THREAD_COUNT);
+    thread_count = Min(thread_count, count);
+
+    std::atomic<u32> next_index{0};
+    auto work = [&]() {
+        for (u32 index = next_index++; index < count; index = next_index++) body(index);
+    };
+    std::thread threads[PARALLEL_MAX_THREAD_COUNT];
+    for (u32 i = 1; i < thread_count; i++) threads[i] = std::thread(work);
+
+    work();
+    for (u32 i = 1; i < thread_count; i++) threads[i].join();
+}
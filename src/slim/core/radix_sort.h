@@ -0,0 +1,66 @@
+#pragma once
+
+#include "./parallel.h"
+
+#define RADIX_SORT_DIGIT_BITS 11
+#define RADIX_SORT_BUCKET_COUNT (1 << RADIX_SORT_DIGIT_BITS)
+#define RADIX_SORT_MAX_BLOCK_COUNT 64
+#define RADIX_SORT_MIN_BLOCK_SIZE 16384
+
+INLINE u32 getBitCount(u64 value) {
+    u32 bit_count = 0;
+    while (value) { value >>= 1; bit_count++; }
+    return bit_count;
+}
+
+// Stable LSD radix sort of the lowest key_bits bits of the keys (higher bits are ignored), using scratch
+// as the other half of a ping-pong buffer. Returns whichever of the 2 ends up holding the sorted keys.
+// Keys are split into fixed blocks that are histogrammed and scattered in parallel, so the result does
+// not depend on the thread count:
+u64* radixSort(u64 *keys, u64 *scratch, u32 count, u32 key_bits) {
+    u32 block_count = Min((count + RADIX_SORT_MIN_BLOCK_SIZE - 1) / RADIX_SORT_MIN_BLOCK_SIZE, (u32)RADIX_SORT_MAX_BLOCK_COUNT);
+    if (!block_count) return keys;
+    const u32 block_size = (count + block_count - 1) / block_count;
+    block_count = (count + block_size - 1) / block_size;
+
+    u32 *offsets = new u32[block_count * RADIX_SORT_BUCKET_COUNT];
+    u64 *source = keys;
+    u64 *target = scratch;
+    for (u32 shift = 0; shift < key_bits; shift += RADIX_SORT_DIGIT_BITS) {
+        const u64 mask = RADIX_SORT_BUCKET_COUNT - 1;
+        parallelFor(block_count, [&](u32 first_block, u32 end_block) {
+            for (u32 b = first_block; b < end_block; b++) {
+                u32 *block_offsets = offsets + b * RADIX_SORT_BUCKET_COUNT;
+                for (u32 i = 0; i < RADIX_SORT_BUCKET_COUNT; i++) block_offsets[i] = 0;
+
+                const u32 end = Min(count, (b + 1) * block_size);
+                for (u32 i = b * block_size; i < end; i++) block_offsets[(source[i] >> shift) & mask]++;
+            }
+        }, 1);
+
+        // Each block's part of a bucket comes after the previous blocks' parts of it:
+        u32 offset = 0;
+        for (u32 bucket = 0; bucket < RADIX_SORT_BUCKET_COUNT; bucket++)
+            for (u32 b = 0; b < block_count; b++) {
+                u32 &block_offset = offsets[b * RADIX_SORT_BUCKET_COUNT + bucket];
+                u32 bucket_count = block_offset;
+                block_offset = offset;
+                offset += bucket_count;
+            }
+
+        parallelFor(block_count, [&](u32 first_block, u32 end_block) {
+            for (u32 b = first_block; b < end_block; b++) {
+                u32 *block_offsets = offsets + b * RADIX_SORT_BUCKET_COUNT;
+                const u32 end = Min(count, (b + 1) * block_size);
+                for (u32 i = b * block_size; i < end; i++) target[block_offsets[(source[i] >> shift) & mask]++] = source[i];
+            }
+        }, 1);
+
+        u64 *sorted = target;
+        target = source;
+        source = sorted;
+    }
+    delete[] offsets;
+
+    return source;
+}
@@ -1,7 +1,25 @@
 #pragma once
 
+#include <atomic>
+
 #include "./base.h"
 
+// Streamed mips have their content address range reserved up front, with pages of it committed and loaded
+// on demand (see serialization/texture_streaming.h):
+#define TEXTURE_PAGE_SIZE Kilobytes(64)
+
+enum TexturePageState : u8 {
+    TexturePageState_Absent,
+    TexturePageState_Resident,
+    TexturePageState_Loading,
+    TexturePageState_Failed   // Its read failed, so it is not requested again
+};
+
+// Mips are stored as plain texels surrounded by a 1-texel apron (wrapped, clamped or taken from the
+// adjacent cube face), so bilinear fetches never need to handle borders.
+// Define SLIM_TEXEL_QUADS to use the legacy layout instead, where every texel corner carries its own
+// copy of the 4 texels around it (faster to fetch from, but takes about 3x the memory):
+#ifdef SLIM_TEXEL_QUADS
 struct TexelQuadComponent {
     u8 TL, TR, BL, BR;
 };
@@ -14,9 +32,26 @@ struct TextureMip {
     u32 width, height;
     TexelQuad *texel_quads;
 
+    INLINE_XPU static u32 GetSizeInBytes(u32 width, u32 height, bool tiled = false) {
+        return sizeof(TexelQuad) * (width + 1) * (height + 1);
+    }
+
+    INLINE_XPU void* content() const { return texel_quads; }
+    INLINE_XPU void setContent(void *content) { texel_quads = (TexelQuad*)content; }
+
+    INLINE_XPU Pixel texel(u32 x, u32 y) const {
+        const TexelQuad &texel_quad = texel_quads[(y + 1) * (width + 1) + x + 1];
+        return {
+            (f32)texel_quad.R.TL * COLOR_COMPONENT_TO_FLOAT,
+            (f32)texel_quad.G.TL * COLOR_COMPONENT_TO_FLOAT,
+            (f32)texel_quad.B.TL * COLOR_COMPONENT_TO_FLOAT,
+            1.0f
+        };
+    }
+
     INLINE_XPU Pixel sample(f32 u, f32 v) const {
-        if (u > 1) u -= (f32)((u32)u);
-        if (v > 1) v -= (f32)((u32)v);
+        if (u < 0 || u > 1) u -= floorf(u);
+        if (v < 0 || v > 1) v -= floorf(v);
 
         const f32 U = u * (f32)width  + 0.5f;
         const f32 V = v * (f32)height + 0.5f;
@@ -39,18 +74,260 @@ struct TextureMip {
                 1.0f
         };
     }
+
+    INLINE_XPU bool isResident(f32 u, f32 v) const { return true; } // Only apron layouts are streamed
+
+    // Samples count (u, v) pairs at once (see _sampleMips below):
+    void sample(const f32 *u, const f32 *v, u32 count, Pixel *pixels) const;
+};
+#else
+struct Texel {
+    u8 B, G, R, A;
+};
+
+struct TextureMip {
+    u32 width, height;
+    Texel *texels; // (width + 2) * (height + 2), including the apron
+    bool tiled = false; // Texels are stored in 4x4 blocks (Morton-ordered within, row-major across)
+
+    // Streamed mips only: A TexturePageState per TEXTURE_PAGE_SIZE bytes of content, and a flag per page
+    // that samplers set whenever they need it (cleared by the streamer once it has loaded or kept the page).
+    // The loader thread publishes a page's content by storing Resident with release semantics:
+    std::atomic<u8> *page_states = nullptr;
+    u8 *used_pages = nullptr;
+
+    INLINE_XPU static u32 GetSizeInBytes(u32 width, u32 height, bool tiled = false) {
+        if (tiled) return sizeof(Texel) * ((width + 5) & ~3) * ((height + 5) & ~3);
+        return sizeof(Texel) * (width + 2) * (height + 2);
+    }
+
+    INLINE_XPU void* content() const { return texels; }
+    INLINE_XPU void setContent(void *content) { texels = (Texel*)content; }
+
+    // Offset of texel (x, y) of the apron-padded grid:
+    INLINE_XPU u32 texelOffset(u32 x, u32 y) const {
+        if (!tiled) return y * (width + 2) + x;
+
+        const u32 block = (y >> 2) * ((width + 5) >> 2) + (x >> 2);
+        return (block << 4) | (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2);
+    }
+
+    INLINE_XPU u32 pageOf(u32 x, u32 y) const {
+        return (u32)((u64)texelOffset(x, y) * sizeof(Texel) / TEXTURE_PAGE_SIZE);
+    }
+
+    INLINE_XPU bool isPageResident(u32 page) const {
+        if (!used_pages[page]) used_pages[page] = 1;
+        return page_states[page].load(std::memory_order_acquire) == TexturePageState_Resident;
+    }
+
+    // Whether the bilinear footprint of (u, v) can be sampled (always, unless the mip is streamed):
+    INLINE_XPU bool isResident(f32 u, f32 v) const {
+        if (!page_states) return true;
+        if (u < 0 || u > 1) u -= floorf(u);
+        if (v < 0 || v > 1) v -= floorf(v);
+
+        const u32 x = (u32)(u * (f32)width  + 0.5f);
+        const u32 y = (u32)(v * (f32)height + 0.5f);
+        const u32 TL = pageOf(x,     y);
+        const u32 TR = pageOf(x + 1, y);
+        const u32 BL = pageOf(x,     y + 1);
+        const u32 BR = pageOf(x + 1, y + 1);
+        bool resident = isPageResident(TL);
+        if (TR != TL) resident = isPageResident(TR) && resident;
+        if (BL != TL) resident = isPageResident(BL) && resident;
+        if (BR != BL && BR != TR) resident = isPageResident(BR) && resident;
+        return resident;
+    }
+
+    INLINE_XPU Pixel texel(u32 x, u32 y) const {
+        const Texel &texel = texels[texelOffset(x + 1, y + 1)];
+        return {
+            (f32)texel.R * COLOR_COMPONENT_TO_FLOAT,
+            (f32)texel.G * COLOR_COMPONENT_TO_FLOAT,
+            (f32)texel.B * COLOR_COMPONENT_TO_FLOAT,
+            1.0f
+        };
+    }
+
+    INLINE_XPU Pixel sample(f32 u, f32 v) const {
+        if (u < 0 || u > 1) u -= floorf(u);
+        if (v < 0 || v > 1) v -= floorf(v);
+
+        const f32 U = u * (f32)width  + 0.5f;
+        const f32 V = v * (f32)height + 0.5f;
+        const u32 x = (u32)U;
+        const u32 y = (u32)V;
+        const f32 r = U - (f32)x;
+        const f32 b = V - (f32)y;
+        const f32 l = 1 - r;
+        const f32 t = 1 - b;
+        const f32 tl = t * l * COLOR_COMPONENT_TO_FLOAT;
+        const f32 tr = t * r * COLOR_COMPONENT_TO_FLOAT;
+        const f32 bl = b * l * COLOR_COMPONENT_TO_FLOAT;
+        const f32 br = b * r * COLOR_COMPONENT_TO_FLOAT;
+
+        // The apron shifts texels by 1, so x/y address the top-left texel of the bilinear footprint:
+        const Texel *TL, *TR, *BL, *BR;
+        if (tiled) {
+            TL = texels + texelOffset(x,     y);
+            TR = texels + texelOffset(x + 1, y);
+            BL = texels + texelOffset(x,     y + 1);
+            BR = texels + texelOffset(x + 1, y + 1);
+        } else {
+            TL = texels + y * (width + 2) + x;
+            BL = TL + (width + 2);
+            TR = TL + 1;
+            BR = BL + 1;
+        }
+#ifdef SLIM_SIMD
+        const __m128i zero = _mm_setzero_si128();
+        __m128i top_texels, bottom_texels;
+        if (tiled) {
+            top_texels    = _mm_unpacklo_epi32(_mm_cvtsi32_si128(*(const int*)TL), _mm_cvtsi32_si128(*(const int*)TR));
+            bottom_texels = _mm_unpacklo_epi32(_mm_cvtsi32_si128(*(const int*)BL), _mm_cvtsi32_si128(*(const int*)BR));
+        } else {
+            top_texels    = _mm_loadl_epi64((const __m128i*)TL);
+            bottom_texels = _mm_loadl_epi64((const __m128i*)BL);
+        }
+        top_texels    = _mm_unpacklo_epi8(top_texels,    zero);
+        bottom_texels = _mm_unpacklo_epi8(bottom_texels, zero);
+        __m128 bgra = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(top_texels, zero)), _mm_set1_ps(tl));
+        bgra = _mm_add_ps(bgra, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(top_texels,    zero)), _mm_set1_ps(tr)));
+        bgra = _mm_add_ps(bgra, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(bottom_texels, zero)), _mm_set1_ps(bl)));
+        bgra = _mm_add_ps(bgra, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(bottom_texels, zero)), _mm_set1_ps(br)));
+
+        alignas(16) f32 components[4];
+        _mm_store_ps(components, bgra);
+        return {components[2], components[1], components[0], 1.0f};
+#else
+        return {
+                fast_mul_add((f32)BR->R, br, fast_mul_add((f32)BL->R, bl, fast_mul_add((f32)TR->R, tr, (f32)TL->R * tl))),
+                fast_mul_add((f32)BR->G, br, fast_mul_add((f32)BL->G, bl, fast_mul_add((f32)TR->G, tr, (f32)TL->G * tl))),
+                fast_mul_add((f32)BR->B, br, fast_mul_add((f32)BL->B, bl, fast_mul_add((f32)TR->B, tr, (f32)TL->B * tl))),
+                1.0f
+        };
+#endif
+    }
+
+    // Samples count (u, v) pairs at once (see _sampleMips below):
+    void sample(const f32 *u, const f32 *v, u32 count, Pixel *pixels) const;
 };
+#endif
+
+
+#define TEXTURE_SAMPLE_LANES 4
+#define TEXTURE_MAX_ANISOTROPY 8
+
+// log2 from the float's bits: Its exponent, plus a quadratic fit over its mantissa (off by at most ~0.01):
+INLINE_XPU f32 fastLog2(f32 x) {
+    union { f32 value; int bits; } float_bits{x};
+    const f32 exponent = (f32)(((float_bits.bits >> 23) & 255) - 128);
+    float_bits.bits = (float_bits.bits & ~(255 << 23)) | (127 << 23);
+    const f32 mantissa = float_bits.value;
+    return exponent + fast_mul_add(fast_mul_add(mantissa, -1.0f / 3.0f, 2.0f), mantissa, -2.0f / 3.0f);
+}
+
+// Bilinearly samples up to TEXTURE_SAMPLE_LANES (u, v) pairs, each from its own mip.
+// Coordinates, addresses and weights are computed for all lanes at once, texels are gathered
+// per lane and then blended one channel at a time across all lanes:
+INLINE void _sampleMips(const TextureMip * const *mips, const f32 *u, const f32 *v, u32 count, Pixel *pixels) {
+#if defined(SLIM_SIMD) && !defined(SLIM_TEXEL_QUADS)
+    alignas(16) f32 lane_u[4], lane_v[4], lane_width[4], lane_height[4];
+    for (u32 i = 0; i < 4; i++) {
+        const u32 lane = i < count ? i : count - 1;
+        lane_u[i] = u[lane];
+        lane_v[i] = v[lane];
+        lane_width[i]  = (f32)mips[lane]->width;
+        lane_height[i] = (f32)mips[lane]->height;
+    }
+
+    const __m128 one  = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 U = _mm_load_ps(lane_u);
+    __m128 V = _mm_load_ps(lane_v);
+    // Coordinates outside [0, 1] wrap as in TextureMip::sample (floor being truncation, less 1 for negatives):
+    const __m128 zero = _mm_setzero_ps();
+    __m128 floor_U = _mm_cvtepi32_ps(_mm_cvttps_epi32(U));
+    __m128 floor_V = _mm_cvtepi32_ps(_mm_cvttps_epi32(V));
+    floor_U = _mm_sub_ps(floor_U, _mm_and_ps(_mm_cmpgt_ps(floor_U, U), one));
+    floor_V = _mm_sub_ps(floor_V, _mm_and_ps(_mm_cmpgt_ps(floor_V, V), one));
+    U = _mm_sub_ps(U, _mm_and_ps(_mm_or_ps(_mm_cmplt_ps(U, zero), _mm_cmpgt_ps(U, one)), floor_U));
+    V = _mm_sub_ps(V, _mm_and_ps(_mm_or_ps(_mm_cmplt_ps(V, zero), _mm_cmpgt_ps(V, one)), floor_V));
+    U = _mm_add_ps(_mm_mul_ps(U, _mm_load_ps(lane_width)),  half);
+    V = _mm_add_ps(_mm_mul_ps(V, _mm_load_ps(lane_height)), half);
+
+    const __m128i X = _mm_cvttps_epi32(U);
+    const __m128i Y = _mm_cvttps_epi32(V);
+    const __m128 r = _mm_sub_ps(U, _mm_cvtepi32_ps(X));
+    const __m128 b = _mm_sub_ps(V, _mm_cvtepi32_ps(Y));
+    const __m128 l = _mm_sub_ps(one, r);
+    const __m128 t = _mm_mul_ps(_mm_sub_ps(one, b), _mm_set1_ps(COLOR_COMPONENT_TO_FLOAT));
+    const __m128 B = _mm_mul_ps(b, _mm_set1_ps(COLOR_COMPONENT_TO_FLOAT));
+    const __m128 tl = _mm_mul_ps(t, l);
+    const __m128 tr = _mm_mul_ps(t, r);
+    const __m128 bl = _mm_mul_ps(B, l);
+    const __m128 br = _mm_mul_ps(B, r);
+
+    alignas(16) int x[4], y[4], TL[4], TR[4], BL[4], BR[4];
+    _mm_store_si128((__m128i*)x, X);
+    _mm_store_si128((__m128i*)y, Y);
+    for (u32 i = 0; i < 4; i++) {
+        const TextureMip &mip = *mips[i < count ? i : count - 1];
+        const u32 X0 = (u32)x[i], X1 = X0 + 1;
+        const u32 Y0 = (u32)y[i], Y1 = Y0 + 1;
+        TL[i] = *(const int*)(mip.texels + mip.texelOffset(X0, Y0));
+        TR[i] = *(const int*)(mip.texels + mip.texelOffset(X1, Y0));
+        BL[i] = *(const int*)(mip.texels + mip.texelOffset(X0, Y1));
+        BR[i] = *(const int*)(mip.texels + mip.texelOffset(X1, Y1));
+    }
+    const __m128i texels_tl = _mm_load_si128((const __m128i*)TL);
+    const __m128i texels_tr = _mm_load_si128((const __m128i*)TR);
+    const __m128i texels_bl = _mm_load_si128((const __m128i*)BL);
+    const __m128i texels_br = _mm_load_si128((const __m128i*)BR);
+    const __m128i component_mask = _mm_set1_epi32(0xFF);
+
+    alignas(16) f32 components[3][4]; // R, G, B
+    for (int c = 0; c < 3; c++) {
+        const int shift = 16 - c * 8;
+        __m128 sum = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels_tl, shift), component_mask)), tl);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels_tr, shift), component_mask)), tr));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels_bl, shift), component_mask)), bl));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels_br, shift), component_mask)), br));
+        _mm_store_ps(components[c], sum);
+    }
+    for (u32 i = 0; i < count; i++)
+        pixels[i] = Pixel{components[0][i], components[1][i], components[2][i], 1.0f};
+#else
+    for (u32 i = 0; i < count; i++)
+        pixels[i] = mips[i]->sample(u[i], v[i]);
+#endif
+}
+
+void TextureMip::sample(const f32 *u, const f32 *v, u32 count, Pixel *pixels) const {
+    const TextureMip *lane_mips[TEXTURE_SAMPLE_LANES];
+    for (u32 i = 0; i < TEXTURE_SAMPLE_LANES; i++) lane_mips[i] = this;
+
+    for (u32 i = 0; i < count; i += TEXTURE_SAMPLE_LANES)
+        _sampleMips(lane_mips, u + i, v + i, Min(count - i, TEXTURE_SAMPLE_LANES), pixels + i);
+}
 
 struct Texture : ImageInfo {
     TextureMip *mips = nullptr;
 
+    // The number of times the texel area has to be quartered to get to 1 or below: Half its log2 rounded up,
+    // which is the float's exponent (bumped by 1 when there is any mantissa):
     XPU static u32 GetMipLevel(f32 texel_area, u32 mip_count) {
-        u32 mip_level = 0;
-        while (texel_area > 1 && ++mip_level < mip_count) texel_area *= 0.25f;
-        if (mip_level >= mip_count)
-            mip_level = mip_count - 1;
+        if (!(texel_area > 1)) return 0;
 
-        return mip_level;
+        union { f32 value; int bits; } area{texel_area};
+        u32 mip_level = (u32)((((area.bits + 0x7FFFFF) >> 23) - 126) >> 1);
+        return mip_level < mip_count ? mip_level : mip_count - 1;
+    }
+
+    // Fractional mip level for trilinear filtering (half the log2 of the texel area):
+    INLINE_XPU static f32 GetMipLevelFraction(f32 texel_area) {
+        return texel_area > 1 ? 0.5f * fastLog2(texel_area) : 0;
     }
 
     XPU static u32 GetMipLevel(u32 width, u32 height, u32 mip_count, f32 uv_coverage) {
@@ -65,108 +342,190 @@ struct Texture : ImageInfo {
         return GetMipLevel(uv_coverage * (f32)(width * height), mip_count);
     }
 
+    // The given mip level, or the nearest coarser one that has the footprint of (u, v) resident (streamed
+    // textures keep their last mip fully resident):
+    INLINE_XPU u32 residentMipLevel(f32 u, f32 v, u32 mip_level) const {
+        while (mip_level < mip_count - 1 && !mips[mip_level].isResident(u, v)) mip_level++;
+        return mip_level;
+    }
+
     INLINE_XPU Pixel sample(f32 u, f32 v, f32 uv_coverage) const {
-        return mips[flags.mipmap ? GetMipLevel(uv_coverage * (f32)(width * height), mip_count) : 0].sample(u, v);
+        const u32 mip_level = flags.mipmap ? GetMipLevel(uv_coverage * (f32)(width * height), mip_count) : 0;
+        return mips[residentMipLevel(u, v, mip_level)].sample(u, v);
     }
 
-    INLINE_XPU Pixel sampleCube(f32 X, f32 Y, f32 Z) const {
-        f32 u, v;
-        u8 mip = 0;
-
-        Sides sides{X, Y, Z};
-////        left{signbit(x)},
-////            bottom{signbit(y)},
-////            back{signbit(z)},
-////            right{!signbit(x)},
-////            top{!signbit(y)},
-////            front{!signbit(z)}
-////        {}
-//
-//        f32 ax = abs(X);
-//        f32 ay = abs(Y);
-//        f32 az = abs(Z);
-//
-//        if (ax < Z)
-
-        f32 z_over_x = X ? (Z / X) : 2;
-        f32 y_over_x = X ? (Y / X) : 2;
-        if (z_over_x <=  1 &&
-            z_over_x >= -1 &&
-            y_over_x <=  1 &&
-            y_over_x >= -1) { // Right or Left
-            u = fast_mul_add(z_over_x, -0.125f, fast_mul_add(0.5f, sides.right, 0.125f));
-            v = fast_mul_add(y_over_x, sides.left - 0.5f, 0.5f);
-        } else {
-            f32 x_over_z = Z ? (X / Z) : 2;
-            f32 y_over_z = Z ? (Y / Z) : 2;
-            if (x_over_z <=  1 &&
-                x_over_z >= -1 &&
-                y_over_z <=  1 &&
-                y_over_z >= -1) { // Front or Back:
-                v = fast_mul_add(y_over_z, signbit(Z) - 0.5f, + 0.5f);
-                u = fast_mul_add(x_over_z, 0.125f, fast_mul_add(signbit(Z), 0.5f, 0.375f));
-            } else { // Top or Bottom
-                u = fast_mul_add(X / abs(Y), 0.5f, 0.5f);
-                v = fast_mul_add(Z / Y, 0.5f, 0.5f);
-                mip = 2 - !signbit(Y);
-            }
+    // Bilinear samples from the 2 mips around a fractional mip level, blended by its fraction:
+    INLINE_XPU Pixel sampleLevel(f32 u, f32 v, f32 mip_level) const {
+        if (mip_level <= 0 || mip_count < 2) return mips[residentMipLevel(u, v, 0)].sample(u, v);
+
+        const u32 last_mip = mip_count - 1;
+        if (mip_level >= (f32)last_mip) return mips[last_mip].sample(u, v);
+
+        const u32 mip = (u32)mip_level;
+        Pixel pixel = mips[residentMipLevel(u, v, mip)].sample(u, v);
+        return pixel.lerpTo(mips[residentMipLevel(u, v, mip + 1)].sample(u, v), mip_level - (f32)mip);
+    }
+
+    INLINE_XPU Pixel sampleTrilinear(f32 u, f32 v, f32 uv_coverage) const {
+        if (!flags.mipmap) return mips[0].sample(u, v);
+        return sampleLevel(u, v, GetMipLevelFraction(uv_coverage * (f32)(width * height)));
+    }
+
+    // Samples an elliptical footprint given by its 2 axes in UV space (e.g. the UV derivatives across a pixel,
+    // or a ray cone projected onto a surface): Up to TEXTURE_MAX_ANISOTROPY trilinear taps are spread along
+    // the major axis, from the mip matching the minor axis (widened when the tap count is clamped):
+    INLINE_XPU Pixel sampleAnisotropic(f32 u, f32 v, f32 major_u, f32 major_v, f32 minor_u, f32 minor_v) const {
+        f32 major_length_squared = major_u * major_u * (f32)(width * width) + major_v * major_v * (f32)(height * height);
+        f32 minor_length_squared = minor_u * minor_u * (f32)(width * width) + minor_v * minor_v * (f32)(height * height);
+        if (major_length_squared < minor_length_squared) {
+            f32 swapped = major_length_squared; major_length_squared = minor_length_squared; minor_length_squared = swapped;
+            swapped = major_u; major_u = minor_u; minor_u = swapped;
+            swapped = major_v; major_v = minor_v; minor_v = swapped;
+        }
+        const f32 major_length = sqrtf(major_length_squared);
+        const f32 minor_length = sqrtf(minor_length_squared);
+
+        u32 tap_count = minor_length * TEXTURE_MAX_ANISOTROPY <= major_length ? TEXTURE_MAX_ANISOTROPY :
+                        (u32)ceilf(major_length / minor_length);
+        if (tap_count < 1) tap_count = 1;
+
+        const f32 footprint_length = Max(minor_length, major_length / (f32)tap_count);
+        const f32 mip_level = flags.mipmap ? GetMipLevelFraction(footprint_length * footprint_length) : 0;
+        if (tap_count == 1) return sampleLevel(u, v, mip_level);
+
+        Pixel pixel{0.0f, 0.0f, 0.0f, 0.0f};
+        const f32 tap_step = 1.0f / (f32)tap_count;
+        f32 offset = tap_step * 0.5f - 0.5f;
+        for (u32 tap = 0; tap < tap_count; tap++, offset += tap_step) {
+            f32 tap_u = fast_mul_add(major_u, offset, u);
+            f32 tap_v = fast_mul_add(major_v, offset, v);
+            if (tap_u < 0 || tap_u > 1) tap_u = flags.wrap ? tap_u - floorf(tap_u) : clampedValue(tap_u);
+            if (tap_v < 0 || tap_v > 1) tap_v = flags.wrap ? tap_v - floorf(tap_v) : clampedValue(tap_v);
+            pixel += sampleLevel(tap_u, tap_v, mip_level);
+        }
+        return pixel * tap_step;
+    }
+
+    // Mip levels for count coverages at once. Equivalent to GetMipLevel, as the number of times the
+    // texel area has to be quartered to get to 1 or below is half its log2 rounded up (taken from the
+    // float's exponent, bumped by 1 when there is any mantissa):
+    void mipLevels(const f32 *uv_coverage, u32 count, u8 *mip_levels) const {
+        u32 i = 0;
+        if (!flags.mipmap) {
+            for (; i < count; i++) mip_levels[i] = 0;
+            return;
         }
+        const f32 area = (f32)(width * height);
+#ifdef SLIM_SIMD
+        const __m128 texel_area = _mm_set1_ps(area);
+        const __m128i exponent_round_up = _mm_set1_epi32(0x7FFFFF);
+        const __m128i exponent_bias = _mm_set1_epi32(127 - 1);
+        const __m128i last_mip_level = _mm_set1_epi32((int)mip_count - 1);
+        const __m128 one = _mm_set1_ps(1.0f);
+        alignas(16) int levels[4];
+        for (; i + 4 <= count; i += 4) {
+            const __m128 areas = _mm_mul_ps(_mm_loadu_ps(uv_coverage + i), texel_area);
+            __m128i bits = _mm_castps_si128(areas);
+            __m128i level = _mm_srai_epi32(_mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(bits, exponent_round_up), 23), exponent_bias), 1);
+            level = _mm_andnot_si128(_mm_srai_epi32(level, 31), level);
+            level = _mm_andnot_si128(_mm_castps_si128(_mm_cmpngt_ps(areas, one)), level); // Mip 0 up to 1 texel (or negative)
+            const __m128i past_last = _mm_cmpgt_epi32(level, last_mip_level);
+            level = _mm_or_si128(_mm_and_si128(past_last, last_mip_level), _mm_andnot_si128(past_last, level));
+            _mm_store_si128((__m128i*)levels, level);
+            for (u32 l = 0; l < 4; l++) mip_levels[i + l] = (u8)levels[l];
+        }
+#endif
+        for (; i < count; i++) mip_levels[i] = (u8)GetMipLevel(uv_coverage[i] * area, mip_count);
+    }
+
+    // Samples count (u, v) pairs at once, each from the mip matching its uv coverage:
+    void sample(const f32 *u, const f32 *v, const f32 *uv_coverage, u32 count, Pixel *pixels) const {
+        u8 mip_levels[TEXTURE_SAMPLE_LANES];
+        const TextureMip *lane_mips[TEXTURE_SAMPLE_LANES];
+        for (u32 i = 0; i < count; i += TEXTURE_SAMPLE_LANES) {
+            u32 lane_count = Min(count - i, TEXTURE_SAMPLE_LANES);
+            mipLevels(uv_coverage + i, lane_count, mip_levels);
+            for (u32 l = 0; l < lane_count; l++) lane_mips[l] = mips + residentMipLevel(u[i + l], v[i + l], mip_levels[l]);
+            _sampleMips(lane_mips, u + i, v + i, lane_count, pixels + i);
+        }
+    }
+
+    // Cube maps are stored as a strip of the -X, +Z, +X and -Z faces (mip 0) followed by the +Y and -Y faces
+    // (mips 1 and 2), each oriented as in GL cube maps (see packCubeMapFaces). The major axis is selected with
+    // compares only, and the face coordinates come from a single reciprocal of its magnitude:
+    INLINE_XPU static void GetCubeCoords(f32 X, f32 Y, f32 Z, f32 &u, f32 &v, u8 &mip) {
+        const f32 ax = fabsf(X);
+        const f32 ay = fabsf(Y);
+        const f32 az = fabsf(Z);
+        const bool x_major = ax >= ay && ax >= az;
+        const bool z_major = !x_major && az >= ay;
+        const bool y_major = !x_major && !z_major;
+        const f32 rcp = 1.0f / (x_major ? ax : (z_major ? az : ay));
+
+        const f32 s = x_major ? Z : X;
+        const f32 t = y_major ? Z : Y;
+        const f32 s_scale  = x_major ? (signbit(X) ?  0.125f : -0.125f) : (z_major ? (signbit(Z) ? -0.125f : 0.125f) : 0.5f);
+        const f32 u_offset = x_major ? (signbit(X) ?  0.125f :  0.625f) : (z_major ? (signbit(Z) ?  0.875f : 0.375f) : 0.5f);
+        const f32 t_scale  = y_major ? (signbit(Y) ? -0.5f : 0.5f) : -0.5f;
+        u = fast_mul_add(s * rcp, s_scale, u_offset);
+        v = fast_mul_add(t * rcp, t_scale, 0.5f);
+        mip = y_major ? (signbit(Y) ? 2 : 1) : 0;
+    }
 
+    INLINE_XPU Pixel sampleCube(f32 X, f32 Y, f32 Z) const {
+        f32 u, v;
+        u8 mip;
+        GetCubeCoords(X, Y, Z, u, v, mip);
         return mips[mip].sample(u, v);
     }
 
-//    INLINE_XPU Pixel sampleCube(f32 x, f32 y, f32 z) const {
-//        f32 x_rcp = 1.0f / x;
-//        f32 y_rcp = 1.0f / y;
-//        f32 z_rcp = 1.0f / z;
-//
-//        OctantShifts octant_shifts{Sides{x, y, z}};
-//        f32 box[6]{-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
-////        vec3 min_t{
-////            x_rcp * box[octant_shifts.x    ],
-////            y_rcp * box[octant_shifts.y + 1],
-////            z_rcp * box[octant_shifts.z + 2]
-////        };
-//        vec3 max_t{
-//            x_rcp * box[3 - octant_shifts.x],
-//            y_rcp * box[4 - octant_shifts.y],
-//            z_rcp * box[5 - octant_shifts.z]
-//        };
-////        f32 near_distance = Max(0, min_t.maximum());
-//        f32 far_distance = max_t.minimum();
-//
-//
-//
-//
-//        u8 mip = ((u8)side & (u8)BoxSide_Bottom) | (((u8)side & (u8)BoxSide_Top) >> 3);
-//        switch (side) {
-//            case
-//        }
-//        f32 z_over_x = X ? (Z / X) : 2;
-//        f32 y_over_x = X ? (Y / X) : 2;
-//        if (z_over_x <=  1 &&
-//            z_over_x >= -1 &&
-//            y_over_x <=  1 &&
-//            y_over_x >= -1) { // Right or Left
-//            u = fast_mul_add(z_over_x, -0.125f, fast_mul_add(0.5f, !signbit(X), 0.125f));
-//            v = fast_mul_add(y_over_x, signbit(X) - 0.5f, 0.5f);
-//        } else {
-//            f32 x_over_z = Z ? (X / Z) : 2;
-//            f32 y_over_z = Z ? (Y / Z) : 2;
-//            if (x_over_z <=  1 &&
-//                x_over_z >= -1 &&
-//                y_over_z <=  1 &&
-//                y_over_z >= -1) { // Front or Back:
-//                v = fast_mul_add(y_over_z, signbit(Z) - 0.5f, + 0.5f);
-//                u = fast_mul_add(x_over_z, 0.125f, fast_mul_add(signbit(Z), 0.5f, 0.375f));
-//            } else { // Top or Bottom
-//                u = fast_mul_add(X / abs(Y), 0.5f, 0.5f);
-//                v = fast_mul_add(Z / Y, 0.5f, 0.5f);
-//                mip = 2 - !signbit(Y);
-//            }
-//        }
-//
-//        return mips[mip].sample(u, v);
-//    }
+    // Samples count directions at once (given as separate X, Y and Z arrays):
+    void sampleCube(const f32 *X, const f32 *Y, const f32 *Z, u32 count, Pixel *pixels) const {
+        f32 u[TEXTURE_SAMPLE_LANES], v[TEXTURE_SAMPLE_LANES];
+        const TextureMip *lane_mips[TEXTURE_SAMPLE_LANES];
+        for (u32 i = 0; i < count; i += TEXTURE_SAMPLE_LANES) {
+            u32 lane_count = Min(count - i, TEXTURE_SAMPLE_LANES);
+#ifdef SLIM_SIMD
+            if (lane_count == 4) {
+                const __m128 sign_mask = _mm_set1_ps(-0.0f);
+                const __m128 x = _mm_loadu_ps(X + i);
+                const __m128 y = _mm_loadu_ps(Y + i);
+                const __m128 z = _mm_loadu_ps(Z + i);
+                const __m128 ax = _mm_andnot_ps(sign_mask, x);
+                const __m128 ay = _mm_andnot_ps(sign_mask, y);
+                const __m128 az = _mm_andnot_ps(sign_mask, z);
+                const __m128 x_major = _mm_and_ps(_mm_cmpge_ps(ax, ay), _mm_cmpge_ps(ax, az));
+                const __m128 z_major = _mm_andnot_ps(x_major, _mm_cmpge_ps(az, ay));
+                const __m128 y_major = _mm_andnot_ps(_mm_or_ps(x_major, z_major), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+#define SELECT(mask, a, b) _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+                const __m128 rcp = _mm_div_ps(_mm_set1_ps(1.0f), SELECT(x_major, ax, SELECT(z_major, az, ay)));
+
+                // Scales of the face's s coordinate flip along with the sign of its major axis (as in GetCubeCoords):
+                const __m128 s = SELECT(x_major, z, x);
+                const __m128 t = SELECT(y_major, z, y);
+                const __m128 x_negative = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(x), 31));
+                const __m128 z_negative = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(z), 31));
+                const __m128 s_scale = SELECT(x_major, _mm_xor_ps(_mm_set1_ps(-0.125f), _mm_and_ps(sign_mask, x)),
+                                       SELECT(z_major, _mm_xor_ps(_mm_set1_ps( 0.125f), _mm_and_ps(sign_mask, z)), _mm_set1_ps(0.5f)));
+                const __m128 u_offset = SELECT(x_major, SELECT(x_negative, _mm_set1_ps(0.125f), _mm_set1_ps(0.625f)),
+                                        SELECT(z_major, SELECT(z_negative, _mm_set1_ps(0.875f), _mm_set1_ps(0.375f)), _mm_set1_ps(0.5f)));
+                const __m128 t_scale = SELECT(y_major, _mm_xor_ps(_mm_set1_ps(0.5f), _mm_and_ps(sign_mask, y)), _mm_set1_ps(-0.5f));
+#undef SELECT
+                _mm_storeu_ps(u, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, rcp), s_scale), u_offset));
+                _mm_storeu_ps(v, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(t, rcp), t_scale), _mm_set1_ps(0.5f)));
 
+                const int y_major_lanes = _mm_movemask_ps(y_major);
+                const int y_negative_lanes = _mm_movemask_ps(y);
+                for (u32 l = 0; l < 4; l++)
+                    lane_mips[l] = mips + ((y_major_lanes >> l) & 1 ? ((y_negative_lanes >> l) & 1 ? 2 : 1) : 0);
+            } else
+#endif
+            for (u32 l = 0; l < lane_count; l++) {
+                u8 mip;
+                GetCubeCoords(X[i + l], Y[i + l], Z[i + l], u[l], v[l], mip);
+                lane_mips[l] = mips + mip;
+            }
+            _sampleMips(lane_mips, u, v, lane_count, pixels + i);
+        }
+    }
 };
\ No newline at end of file
@@ -4,10 +4,9 @@
 #include "../core/transform.h"
 #include "../scene/box.h"
 
-void drawBox(const Box &box, const Transform &transform, const Viewport &viewport,
-             const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, u8 sides = BOX__ALL_SIDES) {
-
+void drawBox(const Box &box, const Transform &transform, EdgeBatch &batch, u8 sides = BOX__ALL_SIDES) {
     static Box view_space_box;
+    const Viewport &viewport{batch.viewport};
 
     // Transform vertices positions from local-space to world-space and then to view-space:
     for (u8 i = 0; i < BOX__VERTEX_COUNT; i++)
@@ -17,19 +16,26 @@ void drawBox(const Box &box, const Transform &transform, const Viewport &viewpor
     view_space_box.edges.setFrom(view_space_box.vertices);
 
     if (sides == BOX__ALL_SIDES) for (const auto &edge : view_space_box.edges.array)
-        drawEdge(edge, viewport, color, opacity, line_width);
+        batch.add(edge);
     else {
-        if (sides & BoxSide_Front | sides & BoxSide_Top   ) drawEdge(view_space_box.edges.sides.front_top,    viewport, color, opacity, line_width);
-        if (sides & BoxSide_Front | sides & BoxSide_Bottom) drawEdge(view_space_box.edges.sides.front_bottom, viewport, color, opacity, line_width);
-        if (sides & BoxSide_Front | sides & BoxSide_Left  ) drawEdge(view_space_box.edges.sides.front_left,   viewport, color, opacity, line_width);
-        if (sides & BoxSide_Front | sides & BoxSide_Right ) drawEdge(view_space_box.edges.sides.front_right,  viewport, color, opacity, line_width);
-        if (sides & BoxSide_Back  | sides & BoxSide_Top   ) drawEdge(view_space_box.edges.sides.back_top,     viewport, color, opacity, line_width);
-        if (sides & BoxSide_Back  | sides & BoxSide_Bottom) drawEdge(view_space_box.edges.sides.back_bottom,  viewport, color, opacity, line_width);
-        if (sides & BoxSide_Back  | sides & BoxSide_Left  ) drawEdge(view_space_box.edges.sides.back_left,    viewport, color, opacity, line_width);
-        if (sides & BoxSide_Back  | sides & BoxSide_Right ) drawEdge(view_space_box.edges.sides.back_right,   viewport, color, opacity, line_width);
-        if (sides & BoxSide_Left  | sides & BoxSide_Top   ) drawEdge(view_space_box.edges.sides.left_top,     viewport, color, opacity, line_width);
-        if (sides & BoxSide_Left  | sides & BoxSide_Bottom) drawEdge(view_space_box.edges.sides.left_bottom,  viewport, color, opacity, line_width);
-        if (sides & BoxSide_Right | sides & BoxSide_Top   ) drawEdge(view_space_box.edges.sides.right_top,    viewport, color, opacity, line_width);
-        if (sides & BoxSide_Right | sides & BoxSide_Bottom) drawEdge(view_space_box.edges.sides.right_bottom, viewport, color, opacity, line_width);
+        if (sides & BoxSide_Front | sides & BoxSide_Top   ) batch.add(view_space_box.edges.sides.front_top);
+        if (sides & BoxSide_Front | sides & BoxSide_Bottom) batch.add(view_space_box.edges.sides.front_bottom);
+        if (sides & BoxSide_Front | sides & BoxSide_Left  ) batch.add(view_space_box.edges.sides.front_left);
+        if (sides & BoxSide_Front | sides & BoxSide_Right ) batch.add(view_space_box.edges.sides.front_right);
+        if (sides & BoxSide_Back  | sides & BoxSide_Top   ) batch.add(view_space_box.edges.sides.back_top);
+        if (sides & BoxSide_Back  | sides & BoxSide_Bottom) batch.add(view_space_box.edges.sides.back_bottom);
+        if (sides & BoxSide_Back  | sides & BoxSide_Left  ) batch.add(view_space_box.edges.sides.back_left);
+        if (sides & BoxSide_Back  | sides & BoxSide_Right ) batch.add(view_space_box.edges.sides.back_right);
+        if (sides & BoxSide_Left  | sides & BoxSide_Top   ) batch.add(view_space_box.edges.sides.left_top);
+        if (sides & BoxSide_Left  | sides & BoxSide_Bottom) batch.add(view_space_box.edges.sides.left_bottom);
+        if (sides & BoxSide_Right | sides & BoxSide_Top   ) batch.add(view_space_box.edges.sides.right_top);
+        if (sides & BoxSide_Right | sides & BoxSide_Bottom) batch.add(view_space_box.edges.sides.right_bottom);
     }
+}
+
+void drawBox(const Box &box, const Transform &transform, const Viewport &viewport,
+             const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, u8 sides = BOX__ALL_SIDES) {
+    EdgeBatch batch{viewport, color, opacity, line_width};
+    drawBox(box, transform, batch, sides);
+    batch.flush();
 }
\ No newline at end of file
@@ -12,6 +12,9 @@ void drawBVH(const BVH &bvh, const Transform &transform, const Viewport &viewpor
              u8 line_width = 1) {
     static Box box;
     static Transform box_transform;
+    EdgeBatch root_batch{viewport, BrightCyan, opacity * 0.5f, line_width};
+    EdgeBatch node_batch{viewport, BrightGreen, opacity * 0.5f, line_width};
+    EdgeBatch leaf_batch{viewport, BrightMagenta, opacity * 2.0f, line_width};
 
     for (u32 node_id = 0; node_id < bvh.node_count; node_id++) {
         BVHNode &node = bvh.nodes[node_id];
@@ -21,9 +24,9 @@ void drawBVH(const BVH &bvh, const Transform &transform, const Viewport &viewpor
         box_transform = transform;
         box_transform.scale *= (node.aabb.max - node.aabb.min) * 0.5f;
         box_transform.position = transform.externPos((node.aabb.min + node.aabb.max) * 0.5f);
-        drawBox(box, box_transform, viewport,
-                node.leaf_count ? BrightMagenta : (node_id ? BrightGreen : BrightCyan),
-                node.leaf_count ? opacity * 2.0f : opacity * 0.5f,
-                line_width);
+        drawBox(box, box_transform, node.leaf_count ? leaf_batch : (node_id ? node_batch : root_batch));
     }
+    root_batch.flush();
+    node_batch.flush();
+    leaf_batch.flush();
 }
\ No newline at end of file
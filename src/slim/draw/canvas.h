@@ -8,6 +8,78 @@ enum AntiAliasing {
     SSAA
 };
 
+#ifndef CANVAS_DIRTY_RECTS_CAPACITY
+#define CANVAS_DIRTY_RECTS_CAPACITY 16
+#endif
+
+#ifndef CANVAS_DIRTY_RECT_MERGE_DISTANCE
+#define CANVAS_DIRTY_RECT_MERGE_DISTANCE 16
+#endif
+
+// Regions of a canvas (in canvas pixels, bounds inclusive) that changed since they were last consumed.
+// Rects that come within CANVAS_DIRTY_RECT_MERGE_DISTANCE of each other get merged, and once the list
+// is at capacity new rects are merged into whichever existing one grows the least.
+struct DirtyRects {
+    RectI rects[CANVAS_DIRTY_RECTS_CAPACITY];
+    u8 count = 0;
+    bool full = true;
+
+    INLINE void reset() {
+        count = 0;
+        full = false;
+    }
+
+    void add(RectI rect) {
+        if (full) return;
+
+        for (i32 i = 0; i < (i32)count; i++)
+            if (_areClose(rects[i], rect)) {
+                _merge(rect, rects[i]);
+                rects[i--] = rects[--count];
+            }
+
+        if (count == CANVAS_DIRTY_RECTS_CAPACITY) {
+            u8 best_index = 0;
+            i32 best_growth = 0x7FFFFFFF;
+            for (u8 i = 0; i < count; i++) {
+                RectI merged = rects[i];
+                _merge(merged, rect);
+                i32 growth = _area(merged) - _area(rects[i]);
+                if (growth < best_growth) {
+                    best_growth = growth;
+                    best_index = i;
+                }
+            }
+            _merge(rects[best_index], rect);
+        } else
+            rects[count++] = rect;
+    }
+
+    void add(const DirtyRects &other) {
+        if (other.full) full = true;
+        else for (u8 i = 0; i < other.count; i++) add(other.rects[i]);
+    }
+
+private:
+    INLINE static bool _areClose(const RectI &a, const RectI &b) {
+        return !(
+            a.right  + CANVAS_DIRTY_RECT_MERGE_DISTANCE < b.left || b.right  + CANVAS_DIRTY_RECT_MERGE_DISTANCE < a.left ||
+            a.bottom + CANVAS_DIRTY_RECT_MERGE_DISTANCE < b.top  || b.bottom + CANVAS_DIRTY_RECT_MERGE_DISTANCE < a.top
+        );
+    }
+
+    INLINE static void _merge(RectI &rect, const RectI &other) {
+        rect.left   = Min(rect.left,   other.left);
+        rect.right  = Max(rect.right,  other.right);
+        rect.top    = Min(rect.top,    other.top);
+        rect.bottom = Max(rect.bottom, other.bottom);
+    }
+
+    INLINE static i32 _area(const RectI &rect) {
+        return (rect.right - rect.left + 1) * (rect.bottom - rect.top + 1);
+    }
+};
+
 struct CanvasData {
     Dimensions dimensions;
     AntiAliasing antialias;
@@ -38,28 +110,79 @@ struct Canvas : CanvasData {
         dimensions.update(width, height);
     }
 
+    mutable DirtyRects dirty_rects;   // Regions marked by draw calls since the last clear
+    mutable DirtyRects present_rects; // Regions the last drawToWindow() resolved (cleared or drawn since the one before)
+
+    // Clears only the regions drawn to since the previous clear (everything when the clear values,
+    // the dimensions or the antialiasing mode changed, or when a region was marked as fully dirty).
     void clear(f32 red = 0, f32 green = 0, f32 blue = 0, f32 opacity = 1.0f, f32 depth = INFINITY) const {
-        i32 pixels_width  = dimensions.width;
-        i32 pixels_height = dimensions.height;
-        i32 depths_width  = dimensions.width;
-        i32 depths_height = dimensions.height;
-
-        if (antialias != NoAA) {
-            depths_width *= 2;
-            depths_height *= 2;
-            if (antialias == SSAA) {
-                pixels_width *= 2;
-                pixels_height *= 2;
+        Pixel pixel{red, green, blue, opacity};
+        if (dimensions.width  != _cleared_width ||
+            dimensions.height != _cleared_height ||
+            antialias         != _cleared_antialias ||
+            depth             != _cleared_depth ||
+            pixel.opacity     != _cleared_pixel.opacity ||
+            pixel.color.r     != _cleared_pixel.color.r ||
+            pixel.color.g     != _cleared_pixel.color.g ||
+            pixel.color.b     != _cleared_pixel.color.b)
+            dirty_rects.full = true;
+
+        if (dirty_rects.full) {
+            i32 pixels_width  = dimensions.width;
+            i32 pixels_height = dimensions.height;
+            i32 depths_width  = dimensions.width;
+            i32 depths_height = dimensions.height;
+
+            if (antialias != NoAA) {
+                depths_width *= 2;
+                depths_height *= 2;
+                if (antialias == SSAA) {
+                    pixels_width *= 2;
+                    pixels_height *= 2;
+                }
             }
+
+            i32 pixels_count = pixels_width * pixels_height;
+            i32 depths_count = depths_width * depths_height;
+
+            if (pixels) for (i32 i = 0; i < pixels_count; i++) pixels[i] = pixel;
+            if (depths) for (i32 i = 0; i < depths_count; i++) depths[i] = depth;
+        } else
+            for (u8 i = 0; i < dirty_rects.count; i++)
+                _clearRect(dirty_rects.rects[i], pixel, depth);
+
+        if (_presented) {
+            present_rects.reset();
+            _presented = false;
         }
+        present_rects.add(dirty_rects);
+        dirty_rects.reset();
+
+        _cleared_pixel = pixel;
+        _cleared_depth = depth;
+        _cleared_width = dimensions.width;
+        _cleared_height = dimensions.height;
+        _cleared_antialias = antialias;
+    }
 
-        i32 pixels_count = pixels_width * pixels_height;
-        i32 depths_count = depths_width * depths_height;
+    // Draw calls mark the regions they draw to (in canvas pixels) before drawing them:
+    INLINE void markDirty(const RectI &rect) const {
+        dirty_rects.add(rect);
+    }
 
-        Pixel pixel{red, green, blue, opacity};
+    // Same as markDirty(), for a rect in the coordinates setPixel() takes (which are of sub-pixels with SSAA):
+    INLINE void markDirtyPixels(RectI rect) const {
+        if (antialias == SSAA) {
+            rect.left   >>= 1;
+            rect.right  >>= 1;
+            rect.top    >>= 1;
+            rect.bottom >>= 1;
+        }
+        dirty_rects.add(rect);
+    }
 
-        if (pixels) for (i32 i = 0; i < pixels_count; i++) pixels[i] = pixel;
-        if (depths) for (i32 i = 0; i < depths_count; i++) depths[i] = depth;
+    INLINE void markAllDirty() const {
+        dirty_rects.full = true;
     }
 
     void drawFrom(Canvas& source_canvas, const RectI* source_bounds = nullptr, const RectI* target_bounds = nullptr, f32 opacity = 1.0f, bool blend = true, bool include_depths = false) {
@@ -75,6 +198,7 @@ struct Canvas : CanvasData {
             src *= 2;
             trg *= 2;
         }
+        markDirtyPixels(RectI{trg.left, trg.right - 1, trg.top, trg.bottom - 1});
 
         f32 depth;
 
@@ -116,13 +240,94 @@ struct Canvas : CanvasData {
         }
     }
 
+    // Resolves only the regions that changed since the previous call, and publishes them
+    // through window::dirty_rects so the platform layer can present just those.
     void drawToWindow() const {
-        u32 *content = window::content;
-        Pixel *pixel = pixels;
-        u32 count = window::height * window::width;
+        if (_presented) {
+            present_rects.reset();
+            _presented = false;
+        }
+        present_rects.add(dirty_rects);
+        _presented = true;
+
         u8 step = antialias == SSAA ? 4 : 1;
-        for (u32 i = 0; i < count; i++, content++, pixel += step)
-            *content = getPixelContent(pixel);
+        if (present_rects.full) {
+            u32 *content = window::content;
+            Pixel *pixel = pixels;
+            u32 count = window::height * window::width;
+            for (u32 i = 0; i < count; i++, content++, pixel += step)
+                *content = getPixelContent(pixel);
+
+            window::dirty_rects = nullptr;
+            window::dirty_rects_count = 0;
+            return;
+        }
+
+        RectI bounds{0, Min(window::width, dimensions.width) - 1, 0, Min(window::height, dimensions.height) - 1};
+        for (u8 i = 0; i < present_rects.count; i++) {
+            RectI &rect = present_rects.rects[i];
+            rect -= bounds;
+            if (!rect) {
+                present_rects.rects[i--] = present_rects.rects[--present_rects.count];
+                continue;
+            }
+
+            for (i32 y = rect.top; y <= rect.bottom; y++) {
+                u32 *content = window::content + window::width * y + rect.left;
+                Pixel *pixel = pixels + (dimensions.stride * y + rect.left) * step;
+                for (i32 x = rect.left; x <= rect.right; x++, content++, pixel += step)
+                    *content = getPixelContent(pixel);
+            }
+        }
+
+        window::dirty_rects = present_rects.rects;
+        window::dirty_rects_count = present_rects.count;
+    }
+
+    // Blends a row of coverage values (0 to 255, scaling the opacity) starting at (x, y), without depth: the same
+    // as calling setPixel() for each non-zero one, but with the bounds and antialiasing checked once for the row.
+    // Coordinates are in sub-pixels when the canvas is SSAA.
+    void blendCoverageRow(i32 x, i32 y, const u8 *coverage, i32 count, const Color &color, f32 opacity) const {
+        i32 w = dimensions.width;
+        i32 h = dimensions.height;
+        if (antialias == SSAA) {
+            w <<= 1;
+            h <<= 1;
+        }
+        if (y < 0 || y >= h) return;
+        if (x < 0) {
+            coverage -= x;
+            count += x;
+            x = 0;
+        }
+        if (count > w - x) count = w - x;
+        if (count <= 0) return;
+
+        Color squared_color = color.clamped();
+        squared_color *= squared_color;
+        opacity *= COLOR_COMPONENT_TO_FLOAT;
+
+        if (antialias == SSAA) {
+            // Sub-pixels of a row alternate between the first and second ones of their pixel's quad:
+            u32 row_offset = dimensions.stride * (y >> 1) * 4 + 2 * (y & 1);
+            for (i32 i = 0; i < count; i++, x++) {
+                if (!coverage[i]) continue;
+                u32 offset = row_offset + (x >> 1) * 4 + (x & 1);
+                _blendCoverage(pixels[offset], depths[offset], squared_color, clampedValue(opacity * (f32)coverage[i]));
+            }
+        } else {
+            Pixel *out_pixel = pixels + dimensions.stride * y + x;
+            f32 *out_depth = depths + (dimensions.stride * y + x) * (antialias == MSAA ? 4 : 1);
+            if (antialias == MSAA) {
+                for (i32 i = 0; i < count; i++, out_pixel++, out_depth += 4)
+                    if (coverage[i])
+                        _blendCoverageMSAA(*out_pixel, out_depth, squared_color, clampedValue(opacity * (f32)coverage[i]));
+            } else {
+                for (i32 i = 0; i < count; i++, out_pixel++, out_depth++)
+                    if (coverage[i])
+                        _blendCoverage(*out_pixel, *out_depth, squared_color, clampedValue(opacity * (f32)coverage[i]));
+            }
+        }
     }
 
     INLINE_XPU void setPixel(i32 x, i32 y, const Color &color, f32 opacity = 1.0f, f32 depth = INFINITY, f32 z_top = 0, f32 z_bottom = 0, f32 z_right = 0) const {
@@ -251,6 +456,35 @@ struct Canvas : CanvasData {
 #endif
 
 private:
+    mutable bool _presented = false;
+    mutable Pixel _cleared_pixel;
+    mutable f32 _cleared_depth = INFINITY;
+    mutable u16 _cleared_width = 0;
+    mutable u16 _cleared_height = 0;
+    mutable AntiAliasing _cleared_antialias = NoAA;
+
+    void _clearRect(RectI rect, const Pixel &pixel, f32 depth) const {
+        rect -= RectI{0, dimensions.width - 1, 0, dimensions.height - 1};
+        if (!rect) return;
+
+        u8 pixels_step = antialias == SSAA ? 4 : 1;
+        u8 depths_step = antialias == NoAA ? 1 : 4;
+        i32 row_width = rect.right - rect.left + 1;
+        i32 pixels_count = row_width * pixels_step;
+        i32 depths_count = row_width * depths_step;
+        for (i32 y = rect.top; y <= rect.bottom; y++) {
+            i32 offset = dimensions.stride * y + rect.left;
+            if (pixels) {
+                Pixel *row = pixels + offset * pixels_step;
+                for (i32 i = 0; i < pixels_count; i++) row[i] = pixel;
+            }
+            if (depths) {
+                f32 *row = depths + offset * depths_step;
+                for (i32 i = 0; i < depths_count; i++) row[i] = depth;
+            }
+        }
+    }
+
     static INLINE_XPU bool _isTransparentPixelQuad(Pixel *pixel_quad) {
         return (
                 (pixel_quad[0].opacity == 0.0f) &&
@@ -264,6 +498,36 @@ private:
         return (pixel_quad[0] + pixel_quad[1] + pixel_quad[2] + pixel_quad[3]) * 0.25f;
     }
 
+    // What setPixel() does for a pixel drawn without depth (which always ends up in front):
+    static INLINE void _blendCoverage(Pixel &out_pixel, f32 &out_depth, const Color &squared_color, f32 opacity) {
+        Pixel pixel{squared_color * opacity, opacity};
+        bool is_cleared = out_depth == INFINITY && out_pixel.color.r == 0 && out_pixel.color.g == 0 && out_pixel.color.b == 0;
+        out_pixel = opacity == 1.0f || is_cleared ? pixel : pixel.alphaBlendOver(out_pixel);
+        out_depth = INFINITY;
+    }
+
+    // Same for MSAA, where the pixel's other 3 samples take depth 0 (so they stay behind what's already at 0):
+    static INLINE void _blendCoverageMSAA(Pixel &out_pixel, f32 *out_depth, const Color &squared_color, f32 opacity) {
+        Pixel pixel{squared_color * opacity, opacity};
+        bool is_cleared = out_depth[0] == INFINITY && out_pixel.color.r == 0 && out_pixel.color.g == 0 && out_pixel.color.b == 0;
+        if (opacity == 1.0f || is_cleared) {
+            out_pixel = pixel;
+            out_depth[0] = INFINITY;
+            out_depth[1] = out_depth[2] = out_depth[3] = 0;
+            return;
+        }
+
+        out_depth[0] = INFINITY;
+        Pixel accumulated_pixel{pixel.alphaBlendOver(out_pixel)};
+        for (u8 i = 1; i < 4; i++)
+            if (0 < out_depth[i]) {
+                out_depth[i] = 0;
+                accumulated_pixel += pixel.alphaBlendOver(out_pixel);
+            } else
+                accumulated_pixel += out_pixel.opacity == 1 ? out_pixel : out_pixel.alphaBlendOver(pixel);
+        out_pixel = accumulated_pixel * 0.25f;
+    }
+
     static INLINE_XPU void _sortPixelsByDepth(f32 depth, Pixel *pixel, f32 *out_depth, Pixel *out_pixel, Pixel **background, Pixel **foreground) {
         if (depth == INFINITY || depth < *out_depth) {
             *out_depth = depth;
@@ -21,6 +21,8 @@ void _drawCircle(bool fill, i32 center_x, i32 center_y, i32 radius, const Canvas
     if (!rect)
         return;
 
+    canvas.markDirty(rect);
+
     if (radius <= 1) {
         if (canvas.antialias == SSAA) {
             center_x *= 2;
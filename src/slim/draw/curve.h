@@ -3,10 +3,9 @@
 #include "../draw/edge.h"
 #include "../core/transform.h"
 
-void drawCurve(const Curve &curve, const Transform &transform, const Viewport &viewport,
-               const Color &color = White, f32 opacity = 1.0f, u8 line_width = 0, u32 step_count = CURVE_STEPS) {
-    const Camera &cam = *viewport.camera;
-
+// Local-space positions of a curve's points, one ring of step_count points at a time
+// (spheres get 2 more rings, for their circles on the XZ and YZ planes):
+void generateCurvePositions(const Curve &curve, u32 step_count, vec3 *positions) {
     f32 rotation_step = 1.0f / (f32)step_count;
     f32 helix_center_to_orbit_y_inc = rotation_step * 2;
 
@@ -20,11 +19,8 @@ void drawCurve(const Curve &curve, const Transform &transform, const Viewport &v
     vec3 orbit_to_curve{curve.thickness, 0, 0};
     mat3 rotation{mat3::RotationAroundY(rotation_step)};
     mat3 orbit_to_curve_rotation{mat3::RotationAroundZ(rotation_step_times_rev_count)};
-
-    // Transform vertices positions of edges from view-space to screen-space (w/ culling and clipping):
     mat3 accumulated_orbit_rotation = rotation;
-    vec3 local_position, local_previous_position, current_position, previous_position;
-    Edge edge;
+    vec3 local_position;
 
     for (u32 i = 0; i < step_count; i++) {
         local_position = center_to_orbit = rotation * center_to_orbit;
@@ -38,37 +34,10 @@ void drawCurve(const Curve &curve, const Transform &transform, const Viewport &v
             default: break;
         }
 
-        current_position = cam.internPos(transform.externPos(local_position));
-
-        if (i) {
-            edge.from = previous_position;
-            edge.to   = current_position;
-            drawEdge(edge, viewport, color, opacity, line_width);
-            if (curve.type == CurveType_Sphere) {
-                edge.from.x = local_previous_position.x;
-                edge.from.y = local_previous_position.z;
-                edge.from.z = 0;
-
-                edge.to.x = local_position.x;
-                edge.to.y = local_position.z;
-                edge.to.z = 0;
-
-                edge.from = cam.internPos(transform.externPos(edge.from));
-                edge.to   = cam.internPos(transform.externPos(edge.to));
-                drawEdge(edge, viewport, color, opacity, line_width);
-
-                edge.from.x = 0;
-                edge.from.y = local_previous_position.x;
-                edge.from.z = local_previous_position.z;
-
-                edge.to.x = 0;
-                edge.to.y = local_position.x;
-                edge.to.z = local_position.z;
-
-                edge.from = cam.internPos(transform.externPos(edge.from));
-                edge.to   = cam.internPos(transform.externPos(edge.to));
-                drawEdge(edge, viewport, color, opacity, line_width);
-            }
+        positions[i] = local_position;
+        if (curve.type == CurveType_Sphere) {
+            positions[i + step_count]     = vec3{local_position.x, local_position.z, 0};
+            positions[i + step_count * 2] = vec3{0, local_position.x, local_position.z};
         }
 
         switch (curve.type) {
@@ -76,8 +45,61 @@ void drawCurve(const Curve &curve, const Transform &transform, const Viewport &v
             case CurveType_Coil:  accumulated_orbit_rotation *= rotation; break;
             default: break;
         }
+    }
+}
+
+INLINE void hashCurveField(u64 &version, const void *field, u32 size) {
+    const u8 *bytes = (const u8*)field;
+    for (u32 i = 0; i < size; i++) {
+        version ^= bytes[i];
+        version *= 1099511628211ULL;
+    }
+}
+
+// Hashes the fields one by one, so that padding bytes never change the version:
+INLINE u64 getCurveVersion(const Curve &curve) {
+    u64 version = 14695981039346656037ULL;
+    u32 type = (u32)curve.type;
+    hashCurveField(version, &type, sizeof(type));
+    hashCurveField(version, &curve.revolution_count, sizeof(curve.revolution_count));
+    hashCurveField(version, &curve.thickness, sizeof(curve.thickness));
+    return version;
+}
+
+void drawCurve(const Curve &curve, const Transform &transform, const Viewport &viewport,
+               const Color &color = White, f32 opacity = 1.0f, u8 line_width = 0, u32 step_count = CURVE_STEPS) {
+    static vec3 *positions = nullptr;
+    static u32 positions_capacity = 0;
+    static ViewSpaceVertices scratch;
+
+    u32 ring_count = curve.type == CurveType_Sphere ? 3 : 1;
+    u32 vertex_count = step_count * ring_count;
+
+    // Points are only regenerated and re-projected when the curve, its transform or the camera changed:
+    bool is_current;
+    ViewSpaceVertices *vertices = view_space_cache.get(&curve, getCurveVersion(curve), vertex_count, transform, viewport, is_current);
+    if (!vertices) {
+        if (!scratch.reserve(vertex_count)) return;
+        vertices = &scratch;
+        is_current = false;
+    }
+    if (!is_current) {
+        if (vertex_count > positions_capacity) {
+            if (positions) os::freeMemory(positions);
+            positions = (vec3*)os::getMemory(sizeof(vec3) * vertex_count);
+            positions_capacity = positions ? vertex_count : 0;
+            if (!positions) return;
+        }
+        generateCurvePositions(curve, step_count, positions);
+        transformToViewSpace(positions, vertex_count, transform, viewport, *vertices);
+        view_space_cache.commit(vertices);
+    }
 
-        previous_position = current_position;
-        local_previous_position = local_position;
+    EdgeBatch batch{viewport, color, opacity, line_width};
+    for (u32 ring = 0; ring < ring_count; ring++) {
+        u32 offset = ring * step_count;
+        for (u32 i = 1; i < step_count; i++)
+            batch.add(*vertices, offset + i - 1, offset + i);
     }
+    batch.flush();
 }
\ No newline at end of file
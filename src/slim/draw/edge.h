@@ -2,17 +2,199 @@
 
 #include "./line.h"
 #include "../viewport/viewport.h"
+#include "../viewport/view_space.h"
 
+#ifndef EDGE_BATCH_SIZE
+#define EDGE_BATCH_SIZE 256
+#endif
+
+// Per-pixel attributes of 4 consecutive positions along the major axis of a line:
+struct LineSteps {
+    f32 center[4]; // Minor-axis coordinate of the line's center
+    f32 depth[4];  // Perspective-correct depth (0 when the line has none)
+    f32 cap[4];    // Coverage along the major axis (less than 1 only past the line's ends)
+};
+
+INLINE void _computeLineSteps(LineSteps &steps, i32 major, f32 major_1, f32 major_2, f32 minor_1, f32 grad,
+                              f32 inv_length, f32 one_over_z1, f32 one_over_z_range, bool has_depth) {
+#ifdef SLIM_SIMD
+    __m128 position = _mm_add_ps(_mm_set1_ps((f32)major), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+
+    __m128 offset = _mm_sub_ps(position, _mm_set1_ps(major_1));
+    _mm_storeu_ps(steps.center, _mm_add_ps(_mm_set1_ps(minor_1), _mm_mul_ps(offset, _mm_set1_ps(grad))));
+
+    __m128 cap = _mm_sub_ps(_mm_min_ps(_mm_add_ps(position, half), _mm_set1_ps(major_2)),
+                            _mm_max_ps(_mm_sub_ps(position, half), _mm_set1_ps(major_1)));
+    _mm_storeu_ps(steps.cap, _mm_min_ps(_mm_max_ps(cap, zero), one));
+
+    if (has_depth) {
+        __m128 t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(offset, _mm_set1_ps(inv_length)), zero), one);
+        __m128 one_over_z = _mm_add_ps(_mm_set1_ps(one_over_z1), _mm_mul_ps(t, _mm_set1_ps(one_over_z_range)));
+        _mm_storeu_ps(steps.depth, _mm_div_ps(one, one_over_z));
+    } else
+        _mm_storeu_ps(steps.depth, zero);
+#else
+    for (u8 i = 0; i < 4; i++) {
+        f32 position = (f32)(major + i);
+        f32 offset = position - major_1;
+        steps.center[i] = minor_1 + offset * grad;
+        steps.cap[i] = clampedValue(Min(position + 0.5f, major_2) - Max(position - 0.5f, major_1));
+        steps.depth[i] = has_depth ? 1.0f / (one_over_z1 + clampedValue(offset * inv_length) * one_over_z_range) : 0.0f;
+    }
+#endif
+}
+
+// Draws a batch of screen-space edges (as produced by Viewport::projectEdge) with a distance-based coverage
+// kernel: every pixel gets the overlap of its footprint with a band of line_width pixels (at least 1) across the
+// line (measured perpendicular to it), and the band's ends are cut square at the edge's end points. Depth is
+// interpolated perspective-correctly from the end points' z values (edges with zero z values have no depth),
+// after pulling them depth_bias towards the camera.
+void _drawEdges(const Edge *edges, u32 edge_count, const Canvas &canvas,
+                const Color &color, f32 opacity, u8 line_width, const RectI *viewport_bounds, f32 depth_bias = 0.0f) {
+    RectI bounds{0, canvas.dimensions.width - 1, 0, canvas.dimensions.height - 1};
+    f32 offset_x = 0.0f;
+    f32 offset_y = 0.0f;
+    if (viewport_bounds) {
+        bounds -= *viewport_bounds;
+        offset_x = (f32)viewport_bounds->left;
+        offset_y = (f32)viewport_bounds->top;
+    }
+    if (!bounds)
+        return;
+
+    f32 scale = 1.0f;
+    if (canvas.antialias == SSAA) {
+        scale = 2.0f;
+        bounds.left *= 2;
+        bounds.top *= 2;
+        bounds.right = bounds.right * 2 + 1;
+        bounds.bottom = bounds.bottom * 2 + 1;
+    }
+    const f32 half_width = (f32)Max(line_width, 1) * 0.5f * scale;
+
+    LineSteps steps;
+    f32 x1, y1, z1, x2, y2, z2, tmp;
+    for (u32 e = 0; e < edge_count; e++) {
+        const Edge &edge = edges[e];
+        x1 = (edge.from.x + offset_x) * scale; y1 = (edge.from.y + offset_y) * scale; z1 = edge.from.z;
+        x2 = (edge.to.x   + offset_x) * scale; y2 = (edge.to.y   + offset_y) * scale; z2 = edge.to.z;
+
+        const bool steep = fabsf(y2 - y1) > fabsf(x2 - x1);
+        if (steep) {
+            tmp = x1; x1 = y1; y1 = tmp;
+            tmp = x2; x2 = y2; y2 = tmp;
+        }
+        if (x2 < x1) {
+            tmp = x2; x2 = x1; x1 = tmp;
+            tmp = y2; y2 = y1; y1 = tmp;
+            tmp = z2; z2 = z1; z1 = tmp;
+        }
+        // From here on x is the major axis and y the minor one:
+        const RangeI &major_range = steep ? bounds.y_range : bounds.x_range;
+        const RangeI &minor_range = steep ? bounds.x_range : bounds.y_range;
+
+        f32 length = x2 - x1;
+        f32 inv_length = length > EPS ? 1.0f / length : 0.0f;
+        f32 grad = (y2 - y1) * inv_length;
+        f32 minor_half_width = half_width * sqrtf(1.0f + grad * grad);
+
+        i32 first = Max((i32)floorf(x1 + 0.5f), major_range.first);
+        i32 last  = Min((i32)floorf(x2 + 0.5f), major_range.last);
+        if (first > last)
+            continue;
+
+        i32 band_first = Max((i32)floorf(Min(y1, y2) - minor_half_width - 0.5f), minor_range.first);
+        i32 band_last  = Min((i32)floorf(Max(y1, y2) + minor_half_width + 1.5f), minor_range.last);
+        if (steep) canvas.markDirtyPixels(RectI{band_first, band_last, first, last});
+        else       canvas.markDirtyPixels(RectI{first, last, band_first, band_last});
+
+        bool has_depth = canvas.depths && ((z1 != 0.0f) || (z2 != 0.0f));
+        if (has_depth) {
+            z1 -= depth_bias;
+            z2 -= depth_bias;
+        }
+        f32 one_over_z1 = has_depth ? 1.0f / z1 : 0.0f;
+        f32 one_over_z_range = has_depth ? 1.0f / z2 - one_over_z1 : 0.0f;
+
+        for (i32 major = first; major <= last; major += 4) {
+            _computeLineSteps(steps, major, x1, x2, y1, grad, inv_length, one_over_z1, one_over_z_range, has_depth);
+
+            i32 step_count = Min(4, last - major + 1);
+            for (i32 i = 0; i < step_count; i++) {
+                f32 weight = steps.cap[i] * opacity;
+                if (weight == 0.0f) continue;
+
+                f32 low  = steps.center[i] - minor_half_width;
+                f32 high = steps.center[i] + minor_half_width;
+                i32 minor_first = Max((i32)floorf(low  + 0.5f), minor_range.first);
+                i32 minor_last  = Min((i32)floorf(high + 0.5f), minor_range.last);
+                for (i32 minor = minor_first; minor <= minor_last; minor++) {
+                    f32 coverage = Min((f32)minor + 0.5f, high) - Max((f32)minor - 0.5f, low);
+                    if (coverage <= 0.0f) continue;
+                    if (coverage > 1.0f) coverage = 1.0f;
+
+                    if (steep) canvas.setPixel(minor, major + i, color, coverage * weight, steps.depth[i]);
+                    else       canvas.setPixel(major + i, minor, color, coverage * weight, steps.depth[i]);
+                }
+            }
+        }
+    }
+}
+
+INLINE void drawEdges(const Edge *edges, u32 edge_count, const Canvas &canvas, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1, const RectI *viewport_bounds = nullptr) {
+    _drawEdges(edges, edge_count, canvas, color, opacity, line_width, viewport_bounds);
+}
+
+// Collects view-space edges, culling/clipping and projecting them as they come in,
+// and draws them a full batch at a time through _drawEdges.
+struct EdgeBatch {
+    const Viewport &viewport;
+    Color color;
+    f32 opacity;
+    u8 line_width;
+    u32 count = 0;
+    Edge edges[EDGE_BATCH_SIZE];
+
+    EdgeBatch(const Viewport &viewport, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1) :
+        viewport{viewport}, color{color}, opacity{opacity}, line_width{line_width} {}
+
+    INLINE void add(Edge edge) {
+        if (!viewport.cullAndClipEdge(edge)) return;
+
+        viewport.projectEdge(edge);
+        edges[count++] = edge;
+        if (count == EDGE_BATCH_SIZE) flush();
+    }
+
+    // For edges that are already known to be inside the frustum and projected to screen-space:
+    INLINE void addProjected(const Edge &edge) {
+        edges[count++] = edge;
+        if (count == EDGE_BATCH_SIZE) flush();
+    }
+
+    // Trivially rejects or accepts the edge by the outcodes of its vertices, only clipping when it straddles:
+    INLINE void add(const ViewSpaceVertices &vertices, u32 from, u32 to) {
+        u8 from_outcode = vertices.outcodes[from];
+        u8 to_outcode   = vertices.outcodes[to];
+        if (from_outcode & to_outcode) return;
+        if (from_outcode | to_outcode)
+            add(Edge{vertices.position(from), vertices.position(to)});
+        else
+            addProjected(Edge{vertices.screenPosition(from), vertices.screenPosition(to)});
+    }
+
+    INLINE void flush() {
+        if (count) _drawEdges(edges, count, viewport.canvas, color, opacity, line_width, &viewport.bounds, EPS);
+        count = 0;
+    }
+};
 
 void drawEdge(Edge edge, const Viewport &viewport, const Color &color = White, f32 opacity = 1.0f, u8 line_width = 1) {
     if (!viewport.cullAndClipEdge(edge)) return;
 
     viewport.projectEdge(edge);
-    drawLine(edge.from.x,
-             edge.from.y,
-             edge.from.z - EPS,
-             edge.to.x,
-             edge.to.y,
-             edge.to.z - EPS,
-             viewport.canvas, color, opacity, line_width, &viewport.bounds);
+    _drawEdges(&edge, 1, viewport.canvas, color, opacity, line_width, &viewport.bounds, EPS);
 }
\ No newline at end of file
@@ -21,6 +21,8 @@ void drawGrid(const Grid &grid, const Transform &transform, const Viewport &view
     // Distribute transformed vertices positions to edges:
     view_space_grid.edges.update(view_space_grid.vertices, grid.u_segments, grid.v_segments);
 
-    for (u8 u = 0; u < grid.u_segments; u++) drawEdge(view_space_grid.edges.u.edges[u], viewport, color, opacity, line_width);
-    for (u8 v = 0; v < grid.v_segments; v++) drawEdge(view_space_grid.edges.v.edges[v], viewport, color, opacity, line_width);
+    EdgeBatch batch{viewport, color, opacity, line_width};
+    for (u8 u = 0; u < grid.u_segments; u++) batch.add(view_space_grid.edges.u.edges[u]);
+    for (u8 v = 0; v < grid.v_segments; v++) batch.add(view_space_grid.edges.v.edges[v]);
+    batch.flush();
 }
\ No newline at end of file
@@ -31,8 +31,16 @@ void drawHUD(const HUD &hud, const Canvas &canvas, const RectI *viewport_bounds
         alt = line->use_alternate && *line->use_alternate;
         ColorID color = alt ? line->alternate_value_color : line->value_color;
         char *text = alt ? line->alternate_value.char_ptr : line->value.string.char_ptr;
-        _drawText(line->title.char_ptr, x, y, canvas, line->title_color, 1.0f, viewport_bounds);
-        _drawText(text, x + (i32)line->title.length * FONT_WIDTH, y, canvas, color, 1.0f, viewport_bounds);
+        if (hud.settings.cache_text) {
+            _drawCachedText(line->title.char_ptr, x, y, canvas, line->title_color, 1.0f, viewport_bounds);
+            if (alt)
+                _drawCachedText(text, x + (i32)line->title.length * FONT_WIDTH, y, canvas, color, 1.0f, viewport_bounds);
+            else
+                _drawText(text, x + (i32)line->title.length * FONT_WIDTH, y, canvas, color, 1.0f, viewport_bounds);
+        } else {
+            _drawText(line->title.char_ptr, x, y, canvas, line->title_color, 1.0f, viewport_bounds);
+            _drawText(text, x + (i32)line->title.length * FONT_WIDTH, y, canvas, color, 1.0f, viewport_bounds);
+        }
         y += (i32)(hud.settings.line_height * (f32)FONT_HEIGHT);
     }
 }
\ No newline at end of file
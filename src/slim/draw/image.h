@@ -25,6 +25,7 @@ void drawImage(const PixelImage &image, const Canvas &canvas, RectI bounds, f32
     Pixel *pixel = image.content;
     if (image.flags.tile) {
         TiledGridInfo grid{image};
+        canvas.markDirtyPixels(RectI{0, (i32)(grid.columns * image.tile_width) - 1, 0, (i32)(grid.rows * image.tile_height) - 1});
         u32 X, Y = 0;
         for (grid.row = 0; grid.row < grid.rows; grid.row++) {
             X = 0;
@@ -41,6 +42,7 @@ void drawImage(const PixelImage &image, const Canvas &canvas, RectI bounds, f32
             Y += image.tile_height;
         }
     } else {
+        canvas.markDirtyPixels(bounds);
         i32 remainder_x = image_width - width;
         for (i32 y = bounds.top; y <= bounds.bottom; y++) {
             for (i32 x = bounds.left; x <= bounds.right; x++, pixel++)
@@ -78,6 +80,7 @@ void drawImage(const FloatImage &image, const Canvas &canvas, RectI bounds, f32
     f32 *channel = image.content;
     if (image.flags.tile) {
         TiledGridInfo grid{image};
+        canvas.markDirtyPixels(RectI{0, (i32)(grid.columns * image.tile_width) - 1, 0, (i32)(grid.rows * image.tile_height) - 1});
         u32 X, Y = 0;
         for (grid.row = 0; grid.row < grid.rows; grid.row++) {
             X = 0;
@@ -104,6 +107,7 @@ void drawImage(const FloatImage &image, const Canvas &canvas, RectI bounds, f32
             Y += image.tile_height;
         }
     } else {
+        canvas.markDirtyPixels(bounds);
         i32 remainder_x = ((i32)image.stride - width) * channels_per_pixel;
         for (i32 y = bounds.top; y <= bounds.bottom; y++) {
             for (i32 x = bounds.left; x <= bounds.right; x++) {
@@ -147,6 +151,7 @@ void drawImage(const ByteColorImage &image, const Canvas &canvas, RectI bounds,
     ByteColor *byte_color = image.content;
     if (image.flags.tile) {
         TiledGridInfo grid{image};
+        canvas.markDirtyPixels(RectI{0, (i32)(grid.columns * image.tile_width) - 1, 0, (i32)(grid.rows * image.tile_height) - 1});
         u32 X, Y = 0;
         for (grid.row = 0; grid.row < grid.rows; grid.row++) {
             X = 0;
@@ -166,6 +171,7 @@ void drawImage(const ByteColorImage &image, const Canvas &canvas, RectI bounds,
             Y += image.tile_height;
         }
     } else {
+        canvas.markDirtyPixels(bounds);
         i32 remainder_x = (i32)image.stride - width;
         for (i32 y = bounds.top; y <= bounds.bottom; y++) {
             for (i32 x = bounds.left; x <= bounds.right; x++, byte_color++) {
@@ -16,6 +16,8 @@ void _drawHLine(RangeI x_range, i32 y, const Canvas &canvas, const Color &color,
     if (!x_range || !y_range[y])
         return;
 
+    canvas.markDirty(RectI{x_range.first, x_range.last, y, y});
+
     if (canvas.antialias == SSAA) {
         y *= 2;
         x_range *= 2;
@@ -44,6 +46,8 @@ void _drawVLine(RangeI y_range, i32 x, const Canvas &canvas, const Color &color,
     if (!y_range || !x_range[x])
         return;
 
+    canvas.markDirty(RectI{x, x, y_range.first, y_range.last});
+
     if (canvas.antialias == SSAA) {
         x *= 2;
         y_range *= 2;
@@ -85,6 +89,7 @@ void _drawLine(f32 x1, f32 y1, f32 z1, f32 x2, f32 y2, f32 z2, const Canvas &can
     RangeI y_range{(i32)float_y_range.first, (i32)(ceilf(float_y_range.last))};
     if (x_range.last == (i32)canvas.dimensions.width) x_range.last--;
     if (y_range.last == (i32)canvas.dimensions.height) y_range.last--;
+    canvas.markDirty(RectI{x_range.first, x_range.last, y_range.first, y_range.last});
 
     i32 x, y;
     if (canvas.antialias == SSAA) {
@@ -2,6 +2,8 @@
 
 #include "./edge.h"
 #include "../scene/mesh.h"
+#include "../core/transform.h"
+#include "../viewport/view_space.h"
 
 
 void drawMesh(const Mesh &mesh, const Transform &transform, bool draw_normals, const Viewport &viewport,
@@ -9,14 +11,30 @@ void drawMesh(const Mesh &mesh, const Transform &transform, bool draw_normals, c
     const Camera &cam = *viewport.camera;
     vec3 pos;
     Edge edge;
+    EdgeBatch batch{viewport, color, opacity, line_width};
     EdgeVertexIndices *edge_index = mesh.edge_vertex_indices;
-    for (u32 i = 0; i < mesh.edge_count; i++, edge_index++) {
-        edge.from = cam.internPos(transform.externPos(mesh.vertex_positions[edge_index->from]));
-        edge.to   = cam.internPos(transform.externPos(mesh.vertex_positions[edge_index->to]));
-        drawEdge(edge, viewport, color, opacity, line_width);
+
+    // Transform, classify and project every vertex once (reusing the results from previous frames
+    // when neither the transform nor the camera changed), then only clip the edges that straddle the frustum:
+    static ViewSpaceVertices scratch;
+    const ViewSpaceVertices *vertices = view_space_cache.get(mesh.vertex_positions, mesh.vertex_count, transform, viewport, mesh.version);
+    if (!vertices && scratch.reserve(mesh.vertex_count)) {
+        transformToViewSpace(mesh.vertex_positions, mesh.vertex_count, transform, viewport, scratch);
+        vertices = &scratch;
     }
+    if (vertices)
+        for (u32 i = 0; i < mesh.edge_count; i++, edge_index++)
+            batch.add(*vertices, edge_index->from, edge_index->to);
+    else
+        for (u32 i = 0; i < mesh.edge_count; i++, edge_index++) {
+            edge.from = cam.internPos(transform.externPos(mesh.vertex_positions[edge_index->from]));
+            edge.to   = cam.internPos(transform.externPos(mesh.vertex_positions[edge_index->to]));
+            batch.add(edge);
+        }
+    batch.flush();
 
     if (draw_normals && mesh.normals_count && mesh.vertex_normals && mesh.vertex_normal_indices) {
+        EdgeBatch normals_batch{viewport, Red, opacity * 0.5f, line_width};
         TriangleVertexIndices *normal_index = mesh.vertex_normal_indices;
         TriangleVertexIndices *position_index = mesh.vertex_position_indices;
         for (u32 t = 0; t < mesh.triangle_count; t++, normal_index++, position_index++) {
@@ -25,8 +43,9 @@ void drawMesh(const Mesh &mesh, const Transform &transform, bool draw_normals, c
                 edge.to = mesh.vertex_normals[normal_index->ids[i]] * 0.1f + pos;
                 edge.from = cam.internPos(transform.externPos(pos));
                 edge.to = cam.internPos(transform.externPos(edge.to));
-                drawEdge(edge, viewport, Red, opacity * 0.5f, line_width);
+                normals_batch.add(edge);
             }
         }
+        normals_batch.flush();
     }
 }
\ No newline at end of file
@@ -26,6 +26,11 @@ void _drawRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity
     if (!rect)
         return;
 
+    if (draw_top)    canvas.markDirty(RectI{rect.left, rect.right, rect.top, rect.top});
+    if (draw_bottom) canvas.markDirty(RectI{rect.left, rect.right, rect.bottom, rect.bottom});
+    if (draw_left)   canvas.markDirty(RectI{rect.left, rect.left, rect.top, rect.bottom});
+    if (draw_right)  canvas.markDirty(RectI{rect.right, rect.right, rect.top, rect.bottom});
+
     if (canvas.antialias == SSAA) {
         rect *= 2;
 
@@ -93,6 +98,8 @@ void _fillRect(RectI rect, const Canvas &canvas, const Color &color, f32 opacity
     if (!rect)
         return;
 
+    canvas.markDirty(rect);
+
     if (canvas.antialias == SSAA) {
         rect *= 2;
 
@@ -111,6 +111,101 @@ u8 *char_addr[] = {bitmap_32,bitmap_33,bitmap_34,bitmap_35,bitmap_36,bitmap_37,b
 
 
 
+#define FONT_GLYPH_COUNT (LAST_CHARACTER_CODE - FIRST_CHARACTER_CODE + 1)
+
+#ifndef TEXT_CACHE_CAPACITY
+#define TEXT_CACHE_CAPACITY 64
+#endif
+
+#ifndef TEXT_CACHE_MEMORY_SIZE
+#define TEXT_CACHE_MEMORY_SIZE (256 * 1024)
+#endif
+
+struct CoverageSpan {
+    u16 first, last; // Blank when last < first
+};
+
+// The bitmaps above decoded once into alpha8 coverage cells, one glyph after the other:
+// FONT_WIDTH x FONT_HEIGHT cells (each texel covering a 2x2 block of font bits) for NoAA/MSAA,
+// and INTERNAL_FONT_WIDTH x INTERNAL_FONT_HEIGHT cells for SSAA, with the lit span of every row.
+namespace font_atlas {
+    u8 alpha[FONT_GLYPH_COUNT][FONT_HEIGHT][FONT_WIDTH];
+    u8 ssaa_alpha[FONT_GLYPH_COUNT][INTERNAL_FONT_HEIGHT][INTERNAL_FONT_WIDTH];
+    CoverageSpan spans[FONT_GLYPH_COUNT][FONT_HEIGHT];
+    CoverageSpan ssaa_spans[FONT_GLYPH_COUNT][INTERNAL_FONT_HEIGHT];
+    bool is_ready = false;
+
+    INLINE CoverageSpan getSpan(const u8 *row, u16 width) {
+        CoverageSpan span{1, 0};
+        for (u16 i = 0; i < width; i++)
+            if (row[i]) {
+                if (span.last < span.first) span.first = i;
+                span.last = i;
+            }
+        return span;
+    }
+
+    void init() {
+        for (u8 glyph = 0; glyph < FONT_GLYPH_COUNT; glyph++) {
+            // Font bits are stored as 3 bands of 8 rows, a byte per column with the top row at the lowest bit:
+            u8 *bytes = char_addr[glyph];
+            for (u8 y = 0; y < INTERNAL_FONT_HEIGHT; y++)
+                for (u8 x = 0; x < INTERNAL_FONT_WIDTH; x++)
+                    ssaa_alpha[glyph][y][x] = bytes[(y >> 3) * INTERNAL_FONT_WIDTH + x] & (1 << (y & 7)) ? 255 : 0;
+
+            for (u8 y = 0; y < FONT_HEIGHT; y++) {
+                for (u8 x = 0; x < FONT_WIDTH; x++) {
+                    u8 *top    = ssaa_alpha[glyph][y * 2    ] + x * 2;
+                    u8 *bottom = ssaa_alpha[glyph][y * 2 + 1] + x * 2;
+                    u16 sum = (u16)top[0] + (u16)top[1] + (u16)bottom[0] + (u16)bottom[1];
+                    alpha[glyph][y][x] = (u8)((sum + 2) / 4);
+                }
+                spans[glyph][y] = getSpan(alpha[glyph][y], FONT_WIDTH);
+            }
+            for (u8 y = 0; y < INTERNAL_FONT_HEIGHT; y++)
+                ssaa_spans[glyph][y] = getSpan(ssaa_alpha[glyph][y], INTERNAL_FONT_WIDTH);
+        }
+        is_ready = true;
+    }
+}
+
+// Blits the lit spans of an alpha8 coverage image whose top-left corner lands at (x, y).
+// Positions and bounds are in canvas pixels, coverage in sub-pixels when the canvas is SSAA.
+void _drawCoverage(const u8 *coverage, const CoverageSpan *spans, u16 width, u16 height, i32 x, i32 y,
+                   const RectI &bounds, const Canvas &canvas, const Color &color, f32 opacity) {
+    u8 shift = canvas.antialias == SSAA ? 1 : 0;
+    RectI sub_bounds{bounds.left << shift, ((bounds.right + 1) << shift) - 1,
+                     bounds.top << shift, ((bounds.bottom + 1) << shift) - 1};
+    x <<= shift;
+    y <<= shift;
+
+    i32 first_row = Max(0, sub_bounds.top - y);
+    i32 last_row  = Min((i32)height - 1, sub_bounds.bottom - y);
+    i32 first_column = Max(0, sub_bounds.left - x);
+    i32 last_column  = Min((i32)width - 1, sub_bounds.right - x);
+    if (first_row > last_row || first_column > last_column) return;
+    canvas.markDirtyPixels(RectI{x + first_column, x + last_column, y + first_row, y + last_row});
+
+    for (i32 row = first_row; row <= last_row; row++) {
+        const CoverageSpan &span = spans[row];
+        if (span.last < span.first) continue;
+
+        i32 first = Max((i32)span.first, first_column);
+        i32 last  = Min((i32)span.last, last_column);
+        if (first <= last)
+            canvas.blendCoverageRow(x + first, y + row, coverage + row * width + first, last - first + 1, color, opacity);
+    }
+}
+
+INLINE void _drawGlyph(u8 glyph, i32 x, i32 y, const RectI &bounds, const Canvas &canvas, const Color &color, f32 opacity) {
+    if (canvas.antialias == SSAA)
+        _drawCoverage(font_atlas::ssaa_alpha[glyph][0], font_atlas::ssaa_spans[glyph],
+                      INTERNAL_FONT_WIDTH, INTERNAL_FONT_HEIGHT, x, y, bounds, canvas, color, opacity);
+    else
+        _drawCoverage(font_atlas::alpha[glyph][0], font_atlas::spans[glyph],
+                      FONT_WIDTH, FONT_HEIGHT, x, y, bounds, canvas, color, opacity);
+}
+
 void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
     RectI bounds{
         0, canvas.dimensions.width - 1,
@@ -126,13 +221,11 @@ void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color
         y + FONT_HEIGHT < bounds.top || y - FONT_HEIGHT > bounds.bottom)
         return;
 
-    f32 pixel_opacity;
+    if (!font_atlas::is_ready) font_atlas::init();
+
     u16 current_x = (u16)x;
     u16 current_y = (u16)y;
-    u16 pixel_x, sub_pixel_x;
-    u16 pixel_y, sub_pixel_y;
     u16 t_offset;
-    u8 *byte_ptr, byte, next_column_byte;
     char character = *str;
     while (character) {
         if (character == '\n') {
@@ -146,43 +239,7 @@ void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color
             current_x += t_offset;
         } else if ((character >= FIRST_CHARACTER_CODE) &&
                    (character <= LAST_CHARACTER_CODE)) {
-            byte_ptr = char_addr[character - FIRST_CHARACTER_CODE];
-            byte = *byte_ptr;
-            next_column_byte = *(byte_ptr + 1);
-            for (int i = 1; i < 4; i++) {
-                pixel_x = current_x;
-                pixel_y = current_y + i * FONT_HEIGHT / 3;
-                for (int w = 0; w < INTERNAL_FONT_WIDTH ; w += 2) {
-                    for (int h = 0; h < 8; h += 2) {
-                        /* skip background bits */
-                        if (bounds.contains(pixel_x, pixel_y)) {
-                            if (canvas.antialias == SSAA) {
-                                sub_pixel_x = pixel_x << 1;
-                                sub_pixel_y = pixel_y << 1;
-
-                                if (byte & (0x80 >> h)) canvas.setPixel(sub_pixel_x, sub_pixel_y + 1, color, opacity);
-                                if (byte & (0x80 >> (h+1))) canvas.setPixel(sub_pixel_x, sub_pixel_y, color, opacity);
-                                if (next_column_byte & (0x80 >> h)) canvas.setPixel(sub_pixel_x+1, sub_pixel_y + 1, color, opacity);
-                                if (next_column_byte & (0x80 >> (h+1))) canvas.setPixel(sub_pixel_x+1, sub_pixel_y, color, opacity);
-                            } else {
-                                pixel_opacity = (byte & (0x80 >> h)) ? 0.25f : 0;
-                                if (byte & (0x80 >> (h+1))) pixel_opacity += 0.25f;
-                                if (next_column_byte & (0x80 >> h)) pixel_opacity += 0.25f;
-                                if (next_column_byte & (0x80 >> (h+1))) pixel_opacity += 0.25f;
-                                if (pixel_opacity != 0.0f) canvas.setPixel(pixel_x, pixel_y, color, pixel_opacity);
-                            }
-                        }
-
-                        pixel_y--;
-                    }
-                    byte_ptr += 2;
-                    byte = *byte_ptr;
-                    next_column_byte = *(byte_ptr + 1);
-
-                    pixel_y += FONT_HEIGHT / 3;
-                    pixel_x++;
-                }
-            }
+            _drawGlyph(character - FIRST_CHARACTER_CODE, current_x, current_y + 1, bounds, canvas, color, opacity);
 
             current_x += FONT_WIDTH;
             if (current_x > bounds.right) {
@@ -201,6 +258,137 @@ void _drawText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color
     }
 }
 
+// Whole strings rendered once into coverage images and re-blitted while their content stays the same.
+// Entries are keyed by the string's content and the canvas's anti-aliasing mode. The color is applied
+// at blit time, so a string shared between differently colored lines is rasterized just once.
+// When either the entries or the memory run out the cache starts over.
+struct CachedText {
+    u64 key;
+    char *str; // A copy of the string in the cache's memory (hashes can collide), not null-terminated
+    u32 length;
+    CoverageSpan *spans;
+    u8 *coverage;
+    u16 width, height; // In sub-pixels for SSAA
+    u16 right, bottom; // Extent in canvas pixels, relative to the text's position
+};
+
+namespace text_cache {
+    CachedText entries[TEXT_CACHE_CAPACITY];
+    u8 memory[TEXT_CACHE_MEMORY_SIZE];
+    u32 entry_count = 0;
+    u32 occupied = 0;
+
+    INLINE void reset() {
+        entry_count = 0;
+        occupied = 0;
+    }
+
+    INLINE u64 getKey(const char *str, AntiAliasing antialias, u32 &length) {
+        u64 key = 14695981039346656037ULL ^ (u64)antialias;
+        length = 0;
+        for (; str[length]; length++) {
+            key ^= (u8)str[length];
+            key *= 1099511628211ULL;
+        }
+        return key;
+    }
+
+    INLINE bool isTextOf(const CachedText &text, const char *str, u32 length) {
+        if (text.length != length) return false;
+        for (u32 i = 0; i < length; i++) if (text.str[i] != str[i]) return false;
+        return true;
+    }
+
+    // Returns nullptr for strings that can not be cached (tabs are positioned relative to the canvas)
+    CachedText* get(const char *str, AntiAliasing antialias) {
+        u32 length;
+        u64 key = getKey(str, antialias, length);
+        for (u32 i = 0; i < entry_count; i++)
+            if (entries[i].key == key && isTextOf(entries[i], str, length))
+                return entries + i;
+
+        u16 columns = 0, line_columns = 0, lines = 1;
+        for (const char *c = str; *c; c++) {
+            if (*c == '\t') return nullptr;
+            if (*c == '\n') {
+                lines++;
+                line_columns = 0;
+            } else if ((*c >= FIRST_CHARACTER_CODE) && (*c <= LAST_CHARACTER_CODE))
+                columns = Max(columns, ++line_columns);
+        }
+        if (!columns) return nullptr;
+
+        u8 scale = antialias == SSAA ? 2 : 1;
+        CachedText text;
+        text.key = key;
+        text.length = length;
+        text.right = columns * FONT_WIDTH - 1;
+        text.bottom = (lines - 1) * LINE_HEIGHT + FONT_HEIGHT;
+        text.width = (text.right + 1) * scale;
+        text.height = (text.bottom + 1) * scale;
+
+        u32 size = text.width * text.height + sizeof(CoverageSpan) * text.height + length;
+        if (size > TEXT_CACHE_MEMORY_SIZE) return nullptr;
+        if (entry_count == TEXT_CACHE_CAPACITY || size > (TEXT_CACHE_MEMORY_SIZE - occupied)) reset();
+
+        text.spans = (CoverageSpan*)(memory + occupied);
+        text.coverage = memory + occupied + sizeof(CoverageSpan) * text.height;
+        text.str = (char*)(text.coverage + text.width * text.height);
+        for (u32 i = 0; i < length; i++) text.str[i] = str[i];
+        occupied += (size + 7) & ~7u;
+        for (u32 i = 0; i < (u32)text.width * text.height; i++) text.coverage[i] = 0;
+
+        if (!font_atlas::is_ready) font_atlas::init();
+        u16 glyph_width  = FONT_WIDTH  * scale;
+        u16 glyph_height = FONT_HEIGHT * scale;
+        u16 x = 0, y = scale;
+        for (const char *c = str; *c; c++) {
+            if (*c == '\n') {
+                x = 0;
+                y += LINE_HEIGHT * scale;
+            } else if ((*c >= FIRST_CHARACTER_CODE) && (*c <= LAST_CHARACTER_CODE)) {
+                u8 glyph = *c - FIRST_CHARACTER_CODE;
+                u8 *glyph_row = scale == 2 ? font_atlas::ssaa_alpha[glyph][0] : font_atlas::alpha[glyph][0];
+                for (u16 row = 0; row < glyph_height; row++, glyph_row += glyph_width) {
+                    u8 *text_row = text.coverage + (y + row) * text.width + x;
+                    for (u16 column = 0; column < glyph_width; column++) text_row[column] = glyph_row[column];
+                }
+                x += glyph_width;
+            }
+        }
+        for (u16 row = 0; row < text.height; row++)
+            text.spans[row] = font_atlas::getSpan(text.coverage + row * text.width, text.width);
+
+        entries[entry_count] = text;
+        return entries + entry_count++;
+    }
+}
+
+void _drawCachedText(char *str, i32 x, i32 y, const Canvas &canvas, const Color &color, f32 opacity, const RectI *viewport_bounds) {
+    RectI bounds{
+        0, canvas.dimensions.width - 1,
+        0, canvas.dimensions.height - 1
+    };
+    i32 text_x = x;
+    i32 text_y = y;
+    if (viewport_bounds) {
+        text_x += viewport_bounds->left;
+        text_y += viewport_bounds->top;
+        bounds -= *viewport_bounds;
+    }
+
+    // Text running past the right edge wraps in _drawText, so leave that to it:
+    CachedText *text = text_x < bounds.left ? nullptr : text_cache::get(str, canvas.antialias);
+    if (!text || text_x + text->right > bounds.right) {
+        _drawText(str, x, y, canvas, color, opacity, viewport_bounds);
+        return;
+    }
+    if (text_y + text->bottom < bounds.top || text_y > bounds.bottom)
+        return;
+
+    _drawCoverage(text->coverage, text->spans, text->width, text->height, text_x, text_y, bounds, canvas, color, opacity);
+}
+
 INLINE void Canvas::drawText(char *str, i32 x, i32 y, const Color &color, f32 opacity, const RectI *viewport_bounds) const {
     _drawText(str, x, y, *this, color, opacity, viewport_bounds);
 }
@@ -225,4 +413,8 @@ INLINE void drawText(char *str, vec2i position, const Canvas &canvas, Color colo
 INLINE void drawText(char *str, vec2 position, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
     _drawText(str, (i32)position.x, (i32)position.y, canvas, color, opacity, viewport_bounds);
 }
-#endif
\ No newline at end of file
+#endif
+
+INLINE void drawCachedText(char *str, i32 x, i32 y, const Canvas &canvas, Color color = White, f32 opacity = 1.0f, const RectI *viewport_bounds = nullptr) {
+    _drawCachedText(str, x, y, canvas, color, opacity, viewport_bounds);
+}
\ No newline at end of file
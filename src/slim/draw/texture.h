@@ -3,6 +3,8 @@
 #include "./canvas.h"
 #include "../core/texture.h"
 
+#define TEXTURE_DRAW_BATCH_SIZE 64
+
 void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const RectI draw_bounds, bool cropped = true, f32 opacity = 1.0f) {
     Color texel_color;
     i32 draw_width = draw_bounds.right - draw_bounds.left+1;
@@ -10,20 +12,21 @@ void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const R
     if (cropped) {
         if (draw_width > (i32)texture_mip.width) draw_width = (i32)texture_mip.width;
         if (draw_height > (i32)texture_mip.height) draw_height = (i32)texture_mip.height;
-        i32 remainder_x = 1 + (i32)texture_mip.width - draw_width;
-        TexelQuad *texel_quad = texture_mip.texel_quads;
+        canvas.markDirtyPixels(RectI{draw_bounds.left, draw_bounds.left + draw_width - 1, draw_bounds.top, draw_bounds.top + draw_height - 1});
         i32 Y = draw_bounds.top;
         for (i32 y = 0; y < draw_height; y++, Y++) {
             i32 X = draw_bounds.left;
-            for (i32 x = 0; x < draw_width; x++, X++, texel_quad++) {
-                texel_color.r = (f32)texel_quad->R.BR * COLOR_COMPONENT_TO_FLOAT;
-                texel_color.g = (f32)texel_quad->G.BR * COLOR_COMPONENT_TO_FLOAT;
-                texel_color.b = (f32)texel_quad->B.BR * COLOR_COMPONENT_TO_FLOAT;
+            for (i32 x = 0; x < draw_width; x++, X++) {
+                texel_color = texture_mip.texel((u32)x, (u32)y).color;
                 canvas.setPixel(X, Y, texel_color, opacity);
             }
-            texel_quad += remainder_x;
         }
     } else {
+        canvas.markDirtyPixels(draw_bounds);
+
+        // Sample a row of texels at a time in batches:
+        f32 us[TEXTURE_DRAW_BATCH_SIZE], vs[TEXTURE_DRAW_BATCH_SIZE];
+        Pixel texels[TEXTURE_DRAW_BATCH_SIZE];
         f32 u_step = 1.0f / (f32)draw_width;
         f32 v_step = 1.0f / (f32)draw_height;
         f32 v = v_step * 0.5f;
@@ -31,9 +34,15 @@ void drawTextureMip(const TextureMip &texture_mip, const Canvas &canvas, const R
         for (i32 y = 0; y < draw_height; y++, Y++, v += v_step) {
             i32 X = draw_bounds.left;
             f32 u = u_step * 0.5f;
-            for (i32 x = 0; x < draw_width; x++, X++, u += u_step) {
-                texel_color = texture_mip.sample(u, v).color;
-                canvas.setPixel(X, Y, texel_color, opacity);
+            for (i32 x = 0; x < draw_width; x += TEXTURE_DRAW_BATCH_SIZE) {
+                u32 count = Min((u32)(draw_width - x), TEXTURE_DRAW_BATCH_SIZE);
+                for (u32 i = 0; i < count; i++, u += u_step) {
+                    us[i] = u;
+                    vs[i] = v;
+                }
+                texture_mip.sample(us, vs, count, texels);
+                for (u32 i = 0; i < count; i++, X++)
+                    canvas.setPixel(X, Y, texels[i].color, opacity);
             }
         }
     }
@@ -50,6 +50,8 @@ void _fillTriangle(f32 x1, f32 y1, f32 z1,
     if (!rect)
         return;
 
+    canvas.markDirty(RectI{(i32)rect.left, (i32)rect.right, (i32)rect.top, (i32)rect.bottom});
+
     if (canvas.antialias == SSAA) {
         x1 *= 2.0f;
         x2 *= 2.0f;
@@ -10,6 +10,8 @@ namespace gl {
         GLFloatUniform roughness;
         GLFloatUniform metalness;
         GLFloatUniform normal_strength;
+        GLFloatUniform albedo_layer;
+        GLFloatUniform normal_layer;
         GLUIntUniform flags;
 
         explicit GLMaterial(const char *variable_name, int index = -1) :
@@ -18,6 +20,8 @@ namespace gl {
             roughness{variable_name, "roughness", nullptr, index},
             metalness{variable_name, "metalness", nullptr, index},
             normal_strength{variable_name, "normal_strength", nullptr, index},
+            albedo_layer{variable_name, "albedo_layer", nullptr, index},
+            normal_layer{variable_name, "normal_layer", nullptr, index},
             flags{variable_name, "flags", nullptr, index}
         {}
 
@@ -27,6 +31,8 @@ namespace gl {
             roughness.setLocation(shader_program_id);
             metalness.setLocation(shader_program_id);
             normal_strength.setLocation(shader_program_id);
+            albedo_layer.setLocation(shader_program_id);
+            normal_layer.setLocation(shader_program_id);
             flags.setLocation(shader_program_id);
         }
 
@@ -36,12 +42,14 @@ namespace gl {
             roughness.update(material.roughness);
             metalness.update(material.metalness);
             normal_strength.update(material.normal_magnitude );
+            albedo_layer.update((f32)material.texture_layers[0]);
+            normal_layer.update((f32)material.texture_layers[1]);
             flags.update(material.flags);
         }
 
         void setBases(const char* bases)
         {
-            albedo.bases = F0.bases = roughness.bases = metalness.bases = normal_strength.bases = flags.bases = bases;
+            albedo.bases = F0.bases = roughness.bases = metalness.bases = normal_strength.bases = albedo_layer.bases = normal_layer.bases = flags.bases = bases;
         }
     };
 }
\ No newline at end of file
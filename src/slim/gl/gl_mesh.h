@@ -8,25 +8,160 @@ struct TriangleVertex {
     vec2 uv;
     vec3 normal;
     vec3 tangent;
+    f32 handedness; // Of the tangent (see getTangentHandedness)
 };
 
+// Positions as 16 bit unorms within the mesh's bounds, uvs as half floats, and normals and tangents
+// as octahedral encodings in 16 bit snorms (decoded in shader.vert):
+struct QuantizedTriangleVertex {
+    u16 position[4]; // The 4th is the tangent's handedness (0 for -1)
+    u16 uv[2];
+    i16 normal[2];
+    i16 tangent[2];
+};
+
+enum GLVertexFormat {
+    GLVertexFormat_Float,    // TriangleVertex (48 bytes)
+    GLVertexFormat_Quantized // QuantizedTriangleVertex (20 bytes)
+};
+
+INLINE u32 roundedToEven(f32 value) {
+    f32 floored = floorf(value);
+    f32 fraction = value - floored;
+    u32 rounded = (u32)floored;
+    return (fraction > 0.5f || (fraction == 0.5f && (rounded & 1))) ? rounded + 1 : rounded;
+}
+
+INLINE u16 toHalfFloat(f32 value) {
+    u16 sign = value < 0 ? 0x8000 : 0;
+    value = fabsf(value);
+    if (value == 0.0f) return sign;
+    if (value != value) return 0x7E00;
 
+    int exponent;
+    f32 mantissa = frexpf(value, &exponent); // value = mantissa * 2^exponent, with mantissa in [0.5, 1)
+    int half_exponent = exponent + 14;
+    if (half_exponent >= 31) return sign | 0x7C00;
+    if (half_exponent <= 0) return sign | (u16)roundedToEven(value * 16777216.0f); // Subnormal: In units of 2^-24
+
+    u32 half_mantissa = roundedToEven((mantissa * 2.0f - 1.0f) * 1024.0f);
+    if (half_mantissa == 1024) {
+        half_mantissa = 0;
+        if (++half_exponent == 31) return sign | 0x7C00;
+    }
+    return sign | (u16)(half_exponent << 10) | (u16)half_mantissa;
+}
+
+INLINE void encodeOctahedral(const vec3 &direction, i16 *encoded) {
+    f32 length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+    if (length == 0.0f) {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+
+    f32 x = direction.x / length;
+    f32 y = direction.y / length;
+    if (direction.z < 0) {
+        f32 folded_x = (1.0f - fabsf(y)) * (x < 0 ? -1.0f : 1.0f);
+        f32 folded_y = (1.0f - fabsf(x)) * (y < 0 ? -1.0f : 1.0f);
+        x = folded_x;
+        y = folded_y;
+    }
+    encoded[0] = (i16)roundf(clampedValue(x, -1.0f, 1.0f) * 32767.0f);
+    encoded[1] = (i16)roundf(clampedValue(y, -1.0f, 1.0f) * 32767.0f);
+}
+
+INLINE void quantizeVertex(const TriangleVertex &vertex, const vec3 &position_offset, const vec3 &position_scale, QuantizedTriangleVertex &quantized) {
+    const vec3 position = (vertex.position - position_offset) / position_scale;
+    quantized.position[0] = (u16)roundf(clampedValue(position.x, 0.0f, 1.0f) * 65535.0f);
+    quantized.position[1] = (u16)roundf(clampedValue(position.y, 0.0f, 1.0f) * 65535.0f);
+    quantized.position[2] = (u16)roundf(clampedValue(position.z, 0.0f, 1.0f) * 65535.0f);
+    quantized.position[3] = vertex.handedness < 0 ? 0 : 65535;
+    quantized.uv[0] = toHalfFloat(vertex.uv.u);
+    quantized.uv[1] = toHalfFloat(vertex.uv.v);
+    encodeOctahedral(vertex.normal, quantized.normal);
+    encodeOctahedral(vertex.tangent, quantized.tangent);
+}
+
+
+// Handedness is per triangle corner, from the direction the triangle's v coordinates grow in:
 template <typename Vertex = TriangleVertex>
 void loadVertices(const Mesh &mesh, Vertex *vertices, bool flip_winding_order = false) {
+    const bool has_handedness = mesh.tangents_count && mesh.normals_count && mesh.uvs_count;
+    vec3 tangent, bitangent;
     for (u32 triangle_index = 0; triangle_index < mesh.triangle_count; triangle_index++) {
+        if (has_handedness) {
+            const TriangleVertexIndices &position_ids = mesh.vertex_position_indices[triangle_index];
+            const TriangleVertexIndices &uv_ids = mesh.vertex_uvs_indices[triangle_index];
+            getTriangleTangents(mesh.vertex_positions[position_ids.v1], mesh.vertex_positions[position_ids.v2], mesh.vertex_positions[position_ids.v3],
+                                mesh.vertex_uvs[uv_ids.v1], mesh.vertex_uvs[uv_ids.v2], mesh.vertex_uvs[uv_ids.v3],
+                                tangent, bitangent);
+        }
         for (u32 vertex_num = 0; vertex_num < 3; vertex_num++, vertices++) {
             u32 v = vertex_num == 0 || !flip_winding_order ? vertex_num : (vertex_num == 2 ? 1 : 2);
             vertices->position = mesh.vertex_positions[mesh.vertex_position_indices[triangle_index].ids[v]];
             if (mesh.uvs_count)      vertices->uv       = mesh.vertex_uvs[      mesh.vertex_uvs_indices[     triangle_index].ids[v]];
             if (mesh.normals_count)  vertices->normal   = mesh.vertex_normals[  mesh.vertex_normal_indices[  triangle_index].ids[v]];
             if (mesh.tangents_count) vertices->tangent  = mesh.vertex_tangents[ mesh.vertex_tangent_indices[ triangle_index].ids[v]];
+            vertices->handedness = has_handedness ? getTangentHandedness(vertices->normal, vertices->tangent, bitangent) : 1.0f;
+        }
+    }
+}
+
+template <typename Vertex = TriangleVertex>
+INLINE u32 hashVertex(const Vertex &vertex) {
+    const u32 *words = (const u32*)&vertex;
+    u32 hash = 2166136261u;
+    for (u32 i = 0; i < sizeof(Vertex) / sizeof(u32); i++) {
+        hash ^= words[i];
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+// Merges vertices that are bitwise identical, writing the index of each vertex's unique vertex to indices.
+// Unique vertices are written in order of first appearance (vertices and unique_vertices may be the same
+// array). Returns the number of unique vertices:
+template <typename Vertex = TriangleVertex>
+u32 weldVertices(const Vertex *vertices, u32 vertex_count, Vertex *unique_vertices, u32 *indices) {
+    u32 table_size = 1;
+    while (table_size < vertex_count * 2) table_size <<= 1;
+    const u32 slot_mask = table_size - 1;
+
+    u32 *table = new u32[table_size];
+    for (u32 i = 0; i < table_size; i++) table[i] = INVALID_VERTEX_INDEX;
+
+    u32 unique_vertex_count = 0;
+    for (u32 i = 0; i < vertex_count; i++) {
+        const Vertex vertex{vertices[i]};
+        for (u32 slot = hashVertex<Vertex>(vertex) & slot_mask; ; slot = (slot + 1) & slot_mask) {
+            const u32 unique_vertex_index = table[slot];
+            if (unique_vertex_index == INVALID_VERTEX_INDEX) {
+                table[slot] = unique_vertex_count;
+                unique_vertices[unique_vertex_count] = vertex;
+                indices[i] = unique_vertex_count++;
+                break;
+            }
+            if (!memcmp(&unique_vertices[unique_vertex_index], &vertex, sizeof(Vertex))) {
+                indices[i] = unique_vertex_index;
+                break;
+            }
         }
     }
+    delete[] table;
+
+    return unique_vertex_count;
 }
 
 struct GLMesh {
     GLuint VAO = 0, VBO = 0, IBO = 0;
     GLsizei index_count = 0;
+    GLenum index_type = GL_UNSIGNED_INT;
+    GLVertexFormat vertex_format = GLVertexFormat_Float;
+
+    // Vertex positions decode as: position * position_scale + position_offset
+    vec3 position_scale{1.0f};
+    vec3 position_offset{0.0f};
 
     GLMesh() = default;
 
@@ -46,69 +181,94 @@ struct GLMesh {
     }
 
 
+    // Triangle corners with identical attributes are welded into shared vertices, drawn through
+    // 16 bit indices when there are few enough of them:
     template <typename Vertex = TriangleVertex>
-    void create(const Mesh &mesh) {
-//        u32 edge_vertex_count = mesh.edge_count * 2;
-        u32 vertex_count = mesh.triangle_count * 3;
-        auto *vertices = new Vertex[vertex_count];
-//        auto *edges = new Edge[mesh.edge_count];
+    void create(const Mesh &mesh, GLVertexFormat format = GLVertexFormat_Float) {
+        u32 corner_count = mesh.triangle_count * 3;
+        auto *vertices = new Vertex[corner_count];
+        auto *indices = new u32[corner_count];
         loadVertices<Vertex>(mesh, vertices);
-//        mesh.loadEdges(edges);
-        /*
-        auto& indices = mesh.vertex_position_indices;
-        for (u32 triangle_index = 0; triangle_index < mesh.triangle_count; triangle_index++) {
-            u32 id1 = indices[triangle_index].ids[0];
-            u32 id2 = indices[triangle_index].ids[1];
-            u32 id3 = indices[triangle_index].ids[2];
-            vec3 v1 = vertices[id1].position;
-            vec3 v2 = vertices[id2].position;
-            vec3 v3 = vertices[id3].position;
-            vec3 e1 = v2 - v1;
-            vec3 e2 = v3 - v1;
-            vec3 n = e1.cross(e2).normalized();
-            vertices[id1].normal += n;
-            vertices[id2].normal += n;
-            vertices[id3].normal += n;
-        }
-        for (u32 vertex_index = 0; vertex_index < vertex_count; vertex_index++) {
-            vertices[vertex_index].normal = -vertices[vertex_index].normal.normalized();
+        if (format == GLVertexFormat_Quantized) {
+            vec3 min{INFINITY}, max{-INFINITY};
+            for (u32 i = 0; i < mesh.vertex_count; i++) {
+                min = minimum(min, mesh.vertex_positions[i]);
+                max = maximum(max, mesh.vertex_positions[i]);
+            }
+            position_offset = min;
+            position_scale = max - min;
+            if (position_scale.x <= 0) position_scale.x = 1;
+            if (position_scale.y <= 0) position_scale.y = 1;
+            if (position_scale.z <= 0) position_scale.z = 1;
+
+            auto *quantized_vertices = new QuantizedTriangleVertex[corner_count];
+            for (u32 i = 0; i < corner_count; i++) quantizeVertex(vertices[i], position_offset, position_scale, quantized_vertices[i]);
+            u32 vertex_count = weldVertices<QuantizedTriangleVertex>(quantized_vertices, corner_count, quantized_vertices, indices);
+            create(quantized_vertices, vertex_count, indices, corner_count, format);
+            delete[] quantized_vertices;
+        } else {
+            u32 vertex_count = weldVertices<Vertex>(vertices, corner_count, vertices, indices);
+            create(vertices, vertex_count, indices, corner_count, format);
         }
-        */
-        create(vertices, vertex_count);
 
         delete[] vertices;
-//        delete[] edges;
+        delete[] indices;
     }
 
-//    template <typename Vertex = TriangleVertex>
-    void create(TriangleVertex *vertices, u32 vertex_count, TriangleVertexIndices *indices = nullptr, u32 indices_count = 0) {
+    // Narrows the indices to 16 bits in place when there are few enough vertices:
+    void create(const void *vertices, u32 vertex_count, u32 *indices, u32 indices_count, GLVertexFormat format) {
+        if (vertex_count <= 0x10000) {
+            auto *short_indices = (u16*)indices;
+            for (u32 i = 0; i < indices_count; i++) short_indices[i] = (u16)indices[i];
+            create(vertices, vertex_count, short_indices, indices_count, GL_UNSIGNED_SHORT, format);
+        } else
+            create(vertices, vertex_count, indices, indices_count, GL_UNSIGNED_INT, format);
+    }
 
+    void create(TriangleVertex *vertices, u32 vertex_count, TriangleVertexIndices *indices = nullptr, u32 indices_count = 0) {
+        create(vertices, vertex_count, indices, indices_count * 3, GL_UNSIGNED_INT);
+    }
 
+    // Indices are either u16 (GL_UNSIGNED_SHORT) or u32 (GL_UNSIGNED_INT), 3 per triangle.
+    // Vertices are TriangleVertex or QuantizedTriangleVertex, as per the format:
+    void create(const void *vertices, u32 vertex_count, const void *indices, u32 indices_count, GLenum indices_type,
+                GLVertexFormat format = GLVertexFormat_Float) {
+        vertex_format = format;
         glGenVertexArrays(1, &VAO);
         glBindVertexArray(VAO);
 
         if (indices && indices_count) {
-            index_count = (GLsizei)(indices_count * 3);
-            auto buffer_size = (GLsizei)(sizeof(TriangleVertexIndices) * indices_count);
+            index_count = (GLsizei)indices_count;
+            index_type = indices_type;
+            auto buffer_size = (GLsizeiptr)((indices_type == GL_UNSIGNED_SHORT ? sizeof(u16) : sizeof(u32)) * indices_count);
             glGenBuffers(1, &IBO);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
             glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer_size, indices, GL_STATIC_DRAW);
         } else {
             IBO = 0;
-            index_count = (GLsizei)(vertex_count * 3);
+            index_count = (GLsizei)vertex_count;
         }
 
         glGenBuffers(1, &VBO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(TriangleVertex) * vertex_count, vertices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TriangleVertex), nullptr);
+        if (format == GLVertexFormat_Quantized) {
+            const GLsizei stride = sizeof(QuantizedTriangleVertex);
+            glBufferData(GL_ARRAY_BUFFER, stride * vertex_count, vertices, GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, nullptr);
+            glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)(sizeof(u16) * 4));
+            glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void*)(sizeof(u16) * 6));
+            glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, stride, (void*)(sizeof(u16) * 8));
+        } else {
+            const GLsizei stride = sizeof(TriangleVertex);
+            glBufferData(GL_ARRAY_BUFFER, stride * vertex_count, vertices, GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(vec3)));
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(vec3) + sizeof(vec2)));
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(vec3) + sizeof(vec2) + sizeof(vec3)));
+        }
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TriangleVertex), (void*)(sizeof(vec3)));
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(TriangleVertex), (void*)(sizeof(vec3) + sizeof(vec2)));
         glEnableVertexAttribArray(2);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(TriangleVertex), (void*)(sizeof(vec3) + sizeof(vec2) + sizeof(vec3)));
         glEnableVertexAttribArray(3);
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -124,7 +284,7 @@ struct GLMesh {
 
         if (IBO) {
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-            glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, nullptr);
+            glDrawElements(GL_TRIANGLES, index_count, index_type, nullptr);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         } else {
             glBindBuffer(GL_ARRAY_BUFFER, VBO);
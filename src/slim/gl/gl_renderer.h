@@ -25,13 +25,18 @@ namespace gl {
 			bool normals = false;
 			u8 cube_map_set_index = 0;
 			float IBL_intensity = 1.0f;
+			GLVertexFormat vertex_format = GLVertexFormat_Float; // Of meshes created by init()
+			bool lods = true; // Pick each mesh geometry's LOD by its size on screen
 		};
 
 		const Scene *scene = nullptr;
-		GLMesh *meshes = nullptr;
+		GLMesh *meshes = nullptr; // Of each mesh, followed by those of its LODs
+		u32 *first_mesh_lods = nullptr; // Where each mesh's GLMeshes start
+		u8 *geometry_lods = nullptr; // Picked for each geometry by render()
 		GLEdges *mesh_edges = nullptr;
 		GLEdges *mesh_normals = nullptr;
-		GLTexture *textures = nullptr;
+		GLTextureArray albedo_maps;
+		GLTextureArray normal_maps;
 
 		mat4 view_matrix;
 		mat4 projection_matrix;
@@ -46,6 +51,20 @@ namespace gl {
 		GLCubeMapTexture *radiance_map = nullptr;
 		GLCubeMapTexture *irradiance_map = nullptr;
 
+		INLINE const GLMesh& getMesh(u32 geometry_index) {
+			return meshes[first_mesh_lods[scene->geometries[geometry_index].id] + geometry_lods[geometry_index]];
+		}
+
+		// Passes that only need positions fold the decoding of a mesh's positions into their matrix:
+		INLINE mat4 getPositionDecoding(const GLMesh &mesh) {
+			return {
+				mesh.position_scale.x, 0, 0, 0,
+				0, mesh.position_scale.y, 0, 0,
+				0, 0, mesh.position_scale.z, 0,
+				mesh.position_offset.x, mesh.position_offset.y, mesh.position_offset.z, 1
+			};
+		}
+
 
 		namespace directional_shadow_pass {
 			GLProgram program;
@@ -75,8 +94,9 @@ namespace gl {
 
 				for (u32 i = 0; i < scene->counts.geometries; i++)
 				{
-					mvp.update(model_matrices[i] * shadow_matrix);
-					meshes[scene->geometries[i].id].render();
+					const GLMesh &mesh{getMesh(i)};
+					mvp.update(getPositionDecoding(mesh) * model_matrices[i] * shadow_matrix);
+					mesh.render();
 				}
 				
 				glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -175,8 +195,9 @@ namespace gl {
 
 				for (u32 i = 0; i < scene->counts.geometries; i++)
 				{
-					mvp.update(model_matrices[i]);
-					meshes[scene->geometries[i].id].render();
+					const GLMesh &mesh{getMesh(i)};
+					mvp.update(getPositionDecoding(mesh) * model_matrices[i]);
+					mesh.render();
 				}
 
 				glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -190,11 +211,15 @@ namespace gl {
 			GLMatrix4Uniform view{"view"};
 			GLMatrix4Uniform projection{"projection"};
 			GLVector3Uniform camera_position{"eyePosition"};
+			GLVector3Uniform position_scale{"positionScale"};
+			GLVector3Uniform position_offset{"positionOffset"};
+			GLIntUniform quantized_vertices{"quantizedVertices"};
 
 			GLFloatUniform IBL{"IBL_intensity"};
 			GLMaterial material{"material"};
 			GLTextureUniform albedo_map{"albedo_map"};
 			GLTextureUniform normal_map{"normal_map"};
+			GLIntUniform normal_map_xy{"normal_map_xy"};
 			GLTextureUniform radiance_map_texture{"radiance_map"};
 			GLTextureUniform irradiance_map_texture{"irradiance_map"};
     
@@ -217,9 +242,13 @@ namespace gl {
 				model.setLocation(program.id);
 				projection.setLocation(program.id);
 				camera_position.setLocation(program.id);
+				position_scale.setLocation(program.id);
+				position_offset.setLocation(program.id);
+				quantized_vertices.setLocation(program.id);
 
 				albedo_map.setLocation(program.id);
 				normal_map.setLocation(program.id);
+				normal_map_xy.setLocation(program.id);
 				radiance_map_texture.setLocation(program.id);
 				irradiance_map_texture.setLocation(program.id);
 
@@ -286,21 +315,23 @@ namespace gl {
 
 				albedo_map.update(3);
 				normal_map.update(4);
+				normal_map_xy.update(normal_maps.compression == ImageCompression_BC5);
 				directional_light.shadow_map_texture.update(5);
+				albedo_maps.bind(GL_TEXTURE3);
+				normal_maps.bind(GL_TEXTURE4);
 				
-				
+				// Materials pick their maps by layer (see Material::texture_layers):
 				for (u32 i = 0; i < scene->counts.geometries; i++)
 				{
 					const Geometry &geo{scene->geometries[i]};
 					const Material &geo_material{scene->materials[geo.material_id]};
-					const GLTexture &albedo_map_texture{textures[geo_material.texture_ids[0]]};
-					const GLTexture &normal_map_texture{textures[geo_material.texture_ids[1]]};
-					const GLMesh &mesh{meshes[geo.id]};
+					const GLMesh &mesh{getMesh(i)};
 
 					model.update(model_matrices[i]);
+					position_scale.update(mesh.position_scale);
+					position_offset.update(mesh.position_offset);
+					quantized_vertices.update(mesh.vertex_format == GLVertexFormat_Quantized);
 					material.update(geo_material);
-					albedo_map_texture.bind(GL_TEXTURE3);
-					normal_map_texture.bind(GL_TEXTURE4);
 					mesh.render();
 				}
 				
@@ -315,12 +346,22 @@ namespace gl {
 		void init(Scene &main_scene, CubeMapSet *cube_map_sets, u32 cube_map_sets_count, RawImage *texture_images, u32 texture_count, bool wireframe = false, bool normals = false) {			
 			scene = &main_scene;
 			model_matrices = new mat4[main_scene.counts.geometries];
-			meshes = new GLMesh[main_scene.counts.meshes];
+			geometry_lods = new u8[main_scene.counts.geometries];
+			for (u32 i = 0; i < main_scene.counts.geometries; i++) geometry_lods[i] = 0;
+
+			first_mesh_lods = new u32[main_scene.counts.meshes];
+			u32 gl_mesh_count = 0;
+			for (u32 m = 0; m < main_scene.counts.meshes; m++) {
+				first_mesh_lods[m] = gl_mesh_count;
+				gl_mesh_count += 1 + main_scene.meshes[m].lod_count;
+			}
+			meshes = new GLMesh[gl_mesh_count];
 			if (wireframe) mesh_edges = new GLEdges[main_scene.counts.meshes];
 			if (normals) mesh_normals = new GLEdges[main_scene.counts.meshes];
 			Mesh *mesh = scene->meshes;
 			for (u32 m = 0; m < main_scene.counts.meshes; m++, mesh++) {
-				meshes[m].create(*mesh);
+				for (u32 l = 0; l <= mesh->lod_count; l++)
+					meshes[first_mesh_lods[m] + l].create(mesh->lod(l), settings::vertex_format);
 				if (wireframe) mesh_edges[m].load(mesh->edge_vertex_indices, mesh->edge_count, mesh->vertex_positions, mesh->vertex_count);
 				if (normals) {
 					vec3 *normal_edges = new vec3[mesh->triangle_count * 6];
@@ -340,9 +381,36 @@ namespace gl {
 			}
 
 			if (texture_images && texture_count) {
-				textures = new GLTexture[texture_count];
-				for (u32 i = 0; i < texture_count; i++)
-					new(&textures[i])GLTexture(texture_images[i]);
+				// Gather the images that materials use as albedo/normal maps into 2 texture arrays,
+				// each image getting a single layer however many materials share it:
+				const RawImage **albedo_images = new const RawImage*[texture_count];
+				const RawImage **normal_images = new const RawImage*[texture_count];
+				u8 *image_layers = new u8[texture_count * 2];
+				for (u32 i = 0; i < texture_count * 2; i++) image_layers[i] = 255;
+				u32 albedo_count = 0;
+				u32 normal_count = 0;
+
+				Material *material = main_scene.materials;
+				for (u32 m = 0; m < main_scene.counts.materials; m++, material++) {
+					for (u32 map = 0; map < 2; map++) {
+						// Only the maps the material uses (unused texture ids are left at 0):
+						u8 texture_id = material->texture_ids[map];
+						if (!(map ? material->hasNormalMap() : material->hasAlbedoMap()) || texture_id >= texture_count) continue;
+
+						u8 &layer = image_layers[texture_id * 2 + map];
+						if (layer == 255) {
+							if (map) { layer = (u8)normal_count; normal_images[normal_count++] = &texture_images[texture_id]; }
+							else     { layer = (u8)albedo_count; albedo_images[albedo_count++] = &texture_images[texture_id]; }
+						}
+						material->texture_layers[map] = layer;
+					}
+				}
+				albedo_maps.load(albedo_images, albedo_count);
+				normal_maps.load(normal_images, normal_count);
+
+				delete[] albedo_images;
+				delete[] normal_images;
+				delete[] image_layers;
 			}
 			
 			if (cube_map_sets && cube_map_sets_count) {
@@ -370,6 +438,13 @@ namespace gl {
 			view_projection_matrix = view_matrix * projection_matrix;
 			for (u32 i = 0; i < scene->counts.geometries; i++) model_matrices[i] = Mat4(scene->geometries[i].transform); 
 
+			// Pick LODs once for all passes, so that shadows match what they are cast by:
+			if (settings::lods) {
+				const f32 pixel_angle = 1.0f / (viewport.dimensions.h_height * viewport.camera->focal_length);
+				setGeometryLODs(scene->geometries, scene->counts.geometries, scene->meshes, viewport.camera->position, pixel_angle, geometry_lods);
+			} else
+				for (u32 i = 0; i < scene->counts.geometries; i++) geometry_lods[i] = 0;
+
 			if (!settings::wireframe) {
 				// Generate shadow maps
 				directional_shadow_pass::render(scene->directional_lights[0].shadowMapMatrix());
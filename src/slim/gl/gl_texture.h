@@ -1,6 +1,11 @@
 #pragma once
 
 #include "./gl_base.h"
+#include "../core/image.h"
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
 
 
 
@@ -25,14 +30,34 @@ struct GLTexture {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        glTexImage2D(GL_TEXTURE_2D, 0,                 
-            image.flags.alpha ? GL_RGBA : GL_RGB, 
-            image.width, 
-            image.height, 0, 
-            image.flags.alpha ? GL_RGBA : GL_RGB, 
-            GL_UNSIGNED_BYTE, 
-            image.content);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        if (image.flags.compression) {
+            // Block compressed images come with their whole mip chain:
+            ImageCompression compression = (ImageCompression)image.flags.compression;
+            GLenum format = compression == ImageCompression_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : (
+                            compression == ImageCompression_BC4 ? GL_COMPRESSED_RED_RGTC1 : GL_COMPRESSED_RG_RGTC2);
+            u32 mip_count = image.mip_count ? image.mip_count : 1;
+            u32 width = image.width;
+            u32 height = image.height;
+            const u8 *blocks = image.content;
+            for (u32 mip = 0; mip < mip_count; mip++) {
+                u32 size = getCompressedMipSize(width, height, compression);
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)mip, format, (GLsizei)width, (GLsizei)height, 0, (GLsizei)size, blocks);
+                blocks += size;
+                width  = width  > 1 ? width  / 2 : 1;
+                height = height > 1 ? height / 2 : 1;
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)mip_count - 1);
+            if (mip_count > 1) glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0,
+                image.flags.alpha ? GL_RGBA : GL_RGB,
+                image.width,
+                image.height, 0,
+                image.flags.alpha ? GL_RGBA : GL_RGB,
+                GL_UNSIGNED_BYTE,
+                image.content);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
 
         glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -51,6 +76,82 @@ struct GLTexture {
 };
 
 
+// Layers of equally sized textures, bound once and indexed per draw (e.g. the maps of all materials).
+// Images that are all compressed the same way (with the same dimensions) are uploaded as they are,
+// otherwise they are packed into RGBA layers of the largest dimensions among them (see packImageLayers):
+struct GLTextureArray {
+    GLuint id = 0;
+    u32 layer_count = 0;
+    ImageCompression compression = ImageCompression_None; // Of the layers as uploaded
+
+    bool load(const RawImage *const *images, u32 count) {
+        if (id) destroy();
+        if (!count) return false;
+
+        const RawImage &first = *images[0];
+        u32 width = first.width;
+        u32 height = first.height;
+        bool same_compression = first.flags.compression != 0;
+        for (u32 i = 1; i < count; i++) {
+            const RawImage &image = *images[i];
+            width  = Max(width,  image.width);
+            height = Max(height, image.height);
+            same_compression = same_compression &&
+                image.flags.compression == first.flags.compression &&
+                image.width == first.width && image.height == first.height && image.mip_count == first.mip_count;
+        }
+
+        glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        compression = same_compression ? (ImageCompression)first.flags.compression : ImageCompression_None;
+        if (same_compression) {
+            GLenum format = compression == ImageCompression_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : (
+                            compression == ImageCompression_BC4 ? GL_COMPRESSED_RED_RGTC1 : GL_COMPRESSED_RG_RGTC2);
+            u32 mip_count = first.mip_count ? first.mip_count : 1;
+            u32 offset = 0;
+            for (u32 mip = 0; mip < mip_count; mip++) {
+                u32 size = getCompressedMipSize(width, height, compression);
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)mip, format, (GLsizei)width, (GLsizei)height, (GLsizei)count, 0, (GLsizei)(size * count), nullptr);
+                for (u32 i = 0; i < count; i++)
+                    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)mip, 0, 0, (GLint)i, (GLsizei)width, (GLsizei)height, 1, format, (GLsizei)size, images[i]->content + offset);
+                offset += size;
+                width  = width  > 1 ? width  / 2 : 1;
+                height = height > 1 ? height / 2 : 1;
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)mip_count - 1);
+            if (mip_count == 1) glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        } else {
+            u8 *layers = new u8[width * height * 4 * count];
+            packImageLayers(images, count, width, height, layers);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, (GLsizei)width, (GLsizei)height, (GLsizei)count, 0, GL_RGBA, GL_UNSIGNED_BYTE, layers);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            delete[] layers;
+        }
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        layer_count = count;
+
+        return true;
+    }
+
+    void bind(GLenum slot = GL_TEXTURE1) const {
+        glActiveTexture(slot);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    }
+
+    void destroy() {
+        glDeleteTextures(1, &id);
+        id = 0;
+        layer_count = 0;
+    }
+};
+
+
 struct GLCubeMapTexture {
     GLuint id = 0;
 
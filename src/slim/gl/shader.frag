@@ -19,6 +19,7 @@ in vec4 vCol;
 in vec2 TexCoord;
 in vec3 Normal;
 in vec3 Tangent;
+in float TangentHandedness;
 in vec3 FragPos;
 in vec4 DirectionalLightSpacePos;
 
@@ -69,6 +70,8 @@ struct Material
     vec3 F0;
     float metalness;
     float normal_strength;
+    float albedo_layer;
+    float normal_layer;
     uint flags;
 };
 
@@ -90,8 +93,9 @@ uniform OmniShadowMap omniShadowMaps[MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS];
 uniform samplerCube radiance_map;
 uniform samplerCube irradiance_map;
 
-uniform sampler2D albedo_map;
-uniform sampler2D normal_map;
+uniform sampler2DArray albedo_map;
+uniform sampler2DArray normal_map;
+uniform bool normal_map_xy;
 uniform sampler2D shadow_map;
 
 uniform Material material;
@@ -287,6 +291,11 @@ vec4 CalcSpotLights(vec3 N, vec3 albedo)
 }
 
 vec3 decodeNormal(const vec4 color) {
+    // BC5 normal maps only store X and Y, so Z is reconstructed for them:
+    if (normal_map_xy) {
+        vec2 xy = color.xy * 2.0f - 1.0f;
+        return vec3(xy, sqrt(max(0.0f, 1.0f - dot(xy, xy))));
+    }
     return normalize(color.xyz * 2.0f - 1.0f);
 }
 
@@ -300,12 +309,14 @@ void main()
 {
 	vec3 N = normalize(Normal);
 	vec3 T = normalize(Tangent);
-	vec3 B = cross(T, N);
-	N = normalize(mat3(T, B, N) * decodeNormal(texture(normal_map, TexCoord)));
+	vec3 B = cross(T, N) * (TangentHandedness < 0.0 ? -1.0 : 1.0);
+	if ((material.flags & HAS_NORMAL_MAP) != uint(0)) {
+		N = normalize(mat3(T, B, N) * decodeNormal(texture(normal_map, vec3(TexCoord, material.normal_layer))));
+	}
 	
 	vec3 albedo = material.albedo;
 	if ((material.flags & HAS_ALBEDO_MAP) != uint(0)) {
-		albedo *= texture(albedo_map, TexCoord).rgb;
+		albedo *= texture(albedo_map, vec3(TexCoord, material.albedo_layer)).rgb;
 	}
 	
 	color = CalcDirectionalLight(DirectionalLightSpacePos, N, albedo);
@@ -1,14 +1,15 @@
 #version 330
 
-layout (location = 0) in vec3 pos;
+layout (location = 0) in vec4 pos;     // Tangent handedness in .w for quantized vertices
 layout (location = 1) in vec2 tex;
-layout (location = 2) in vec3 norm;
-layout (location = 3) in vec3 tangent;
+layout (location = 2) in vec3 norm;    // Octahedral in .xy for quantized vertices
+layout (location = 3) in vec4 tangent; // Octahedral in .xy for quantized vertices, handedness in .w otherwise
 
 out vec4 vCol;
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 Tangent;
+out float TangentHandedness;
 out vec3 FragPos;
 out vec4 DirectionalLightSpacePos;
 
@@ -16,18 +17,32 @@ uniform mat4 model;
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 directionalLightTransform;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+uniform bool quantizedVertices;
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-direction.z, 0.0);
+	direction.x += direction.x >= 0.0 ? -fold : fold;
+	direction.y += direction.y >= 0.0 ? -fold : fold;
+	return normalize(direction);
+}
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(pos, 1.0);
-	DirectionalLightSpacePos = directionalLightTransform * model * vec4(pos, 1.0);
+	vec3 position = pos.xyz * positionScale + positionOffset;
+	gl_Position = projection * view * model * vec4(position, 1.0);
+	DirectionalLightSpacePos = directionalLightTransform * model * vec4(position, 1.0);
 	
-	vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
+	vCol = vec4(clamp(position, 0.0f, 1.0f), 1.0f);
 	
 	TexCoord = tex;
 	mat3 normalMatrix = mat3(transpose(inverse(model)));
-	Normal = normalMatrix * norm;
-	Tangent = normalMatrix * tangent;
+	Normal = normalMatrix * (quantizedVertices ? decodeOctahedral(norm.xy) : norm);
+	Tangent = normalMatrix * (quantizedVertices ? decodeOctahedral(tangent.xy) : tangent.xyz);
+	TangentHandedness = quantizedVertices ? pos.w * 2.0 - 1.0 : tangent.w;
 	
-	FragPos = (model * vec4(pos, 1.0)).xyz; 
+	FragPos = (model * vec4(position, 1.0)).xyz; 
 }
\ No newline at end of file
@@ -95,11 +95,21 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
         case WM_PAINT:
             if (CURRENT_APP->blit) {
-                SetDIBitsToDevice(Win32_window_dc,
-                                  0, 0, window::width, window::height,
-                                  0, 0, 0, window::height,
-                                  (u32*)window::content, &Win32_bitmap_info, DIB_RGB_COLORS);
-
+                if (window::dirty_rects) {
+                    for (u8 i = 0; i < window::dirty_rects_count; i++) {
+                        RectI &rect = window::dirty_rects[i];
+                        SetDIBitsToDevice(Win32_window_dc,
+                                          rect.left, window::height - 1 - rect.bottom,
+                                          rect.right - rect.left + 1, rect.bottom - rect.top + 1,
+                                          rect.left, rect.top, 0, window::height,
+                                          (u32*)window::content, &Win32_bitmap_info, DIB_RGB_COLORS);
+                    }
+                } else
+                    SetDIBitsToDevice(Win32_window_dc,
+                                      0, 0, window::width, window::height,
+                                      0, 0, 0, window::height,
+                                      (u32*)window::content, &Win32_bitmap_info, DIB_RGB_COLORS);
+                window::dirty_rects = nullptr;
             }
             CURRENT_APP->_redraw();
             SwapBuffers(Win32_window_dc);
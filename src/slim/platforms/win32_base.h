@@ -223,14 +223,68 @@ void os::freeMemory(void* memory) {
     VirtualFree((void*)memory, 0, MEM_RELEASE);
 }
 
+void* os::reserveMemory(u64 size) {
+    return VirtualAlloc(nullptr, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool os::commitMemory(void* memory, u64 size) {
+    return VirtualAlloc(memory, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+void os::decommitMemory(void* memory, u64 size) {
+    VirtualFree(memory, (SIZE_T)size, MEM_DECOMMIT);
+}
+
 void os::closeFile(void *handle) { return win32_closeFile(handle); }
 void* os::openFileForReading(const char* path) { return win32_openFileForReading(path); }
 void* os::openFileForWriting(const char* path) { return win32_openFileForWriting(path); }
 bool os::readFromFile(LPVOID out, DWORD size, HANDLE handle) { return win32_readFromFile(out, size, handle); }
 bool os::writeToFile(LPVOID out, DWORD size, HANDLE handle) { return win32_writeToFile(out, size, handle); }
+bool os::setFilePosition(void *handle, u64 position) {
+    LARGE_INTEGER distance;
+    distance.QuadPart = (LONGLONG)position;
+    return SetFilePointerEx(handle, distance, nullptr, FILE_BEGIN) != 0;
+}
 long long int os::getFileSizeWithoutOpening(const char* path) { return win32_getFileSizeWithoutOpening(path); }
 long long int os::getFileSize(void *handle) { return win32_getFileSize(handle); }
 void*  os::readEntireFile(const char* file_path, u64 *out_size) { return win32_readEntireFile(file_path, out_size); }
+void* os::mapFileForReading(const char* file_path, u64 *out_size) {
+    HANDLE handle = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER large_size;
+    void *memory = nullptr;
+    if (GetFileSizeEx(handle, &large_size) && large_size.QuadPart) {
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping); // The view keeps the mapping alive
+        }
+    }
+    CloseHandle(handle);
+    *out_size = memory ? (u64)large_size.QuadPart : 0;
+    return memory;
+}
+void os::unmapFile(void *memory) {
+    UnmapViewOfFile(memory);
+}
+// Runs the command line in a child process (sharing the console) and waits for it, returning its exit code
+// (or -1 if it could not be started):
+i32 os::runProcess(char *command_line) {
+    STARTUPINFOA startup_info{};
+    startup_info.cb = sizeof(STARTUPINFOA);
+    PROCESS_INFORMATION process_info{};
+    if (!CreateProcessA(nullptr, command_line, nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup_info, &process_info))
+        return -1;
+
+    DWORD exit_code = (DWORD)-1;
+    WaitForSingleObject(process_info.hProcess, INFINITE);
+    GetExitCodeProcess(process_info.hProcess, &exit_code);
+    CloseHandle(process_info.hProcess);
+    CloseHandle(process_info.hThread);
+    return (i32)exit_code;
+}
 
 void os::print(const char *message, u8 color) {
     HANDLE console_handle = GetStdHandle(STD_OUTPUT_HANDLE);
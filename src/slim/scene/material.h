@@ -88,6 +88,9 @@ struct Material {
     Color emission = 0.0f;
     f32 IOR = 1.0f;
 
+    // Layers of the albedo and normal maps in the GL renderer's texture arrays (set by gl::renderer::init):
+    u8 texture_layers[2] = {0, 0};
+
     INLINE_XPU bool isEmissive() const { return flags & MATERIAL_IS_EMISSIVE; }
     INLINE_XPU bool isReflective() const { return flags & MATERIAL_IS_REFLECTIVE; }
     INLINE_XPU bool isRefractive() const { return flags & MATERIAL_IS_REFRACTIVE; }
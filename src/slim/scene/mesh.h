@@ -2,9 +2,49 @@
 #include <stdio.h>
 #include "../math/vec2.h"
 #include "../math/mat3.h"
+#include "../core/transform.h"
 
 #include "./bvh.h"
 
+#define INVALID_VERTEX_INDEX 0xFFFFFFFF
+
+// Directions in which a triangle's u and v coordinates grow (zero for triangles with degenerate uvs):
+INLINE_XPU void getTriangleTangents(const vec3 &p1, const vec3 &p2, const vec3 &p3,
+                                    const vec2 &uv1, const vec2 &uv2, const vec2 &uv3,
+                                    vec3 &tangent, vec3 &bitangent) {
+    const vec3 edge1 = p2 - p1;
+    const vec3 edge2 = p3 - p1;
+    const vec2 delta_uv1 = uv2 - uv1;
+    const vec2 delta_uv2 = uv3 - uv1;
+    const f32 determinant = delta_uv1.x * delta_uv2.y - delta_uv2.x * delta_uv1.y;
+    const f32 one_over_determinant = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+    tangent   = (edge1 * delta_uv2.y - edge2 * delta_uv1.y) * one_over_determinant;
+    bitangent = (edge2 * delta_uv1.x - edge1 * delta_uv2.x) * one_over_determinant;
+}
+
+// 1 where the uvs map onto the surface as is, -1 where they are mirrored (shaders flip their bitangent there):
+INLINE_XPU f32 getTangentHandedness(const vec3 &normal, const vec3 &tangent, const vec3 &bitangent) {
+    return normal.cross(tangent).dot(bitangent) < 0.0f ? -1.0f : 1.0f;
+}
+
+// Meshes are drawn/traced at full detail while their bounding sphere spans at least MESH_LOD_SCREEN_SIZE pixels,
+// then at the next LOD each time that size shrinks by a factor of sqrt(2): LODs halve the triangle count, so this
+// keeps about as many triangles per pixel on screen.
+#define MESH_LOD_SCREEN_SIZE 256.0f
+#define MESH_LOD_SCREEN_SIZE_STEP 0.70710678f
+#define MESH_MAX_LOD_COUNT 8
+
+INLINE_XPU u32 getLODIndex(u32 lod_count, f32 screen_size) {
+    u32 lod_index = 0;
+    for (f32 size = MESH_LOD_SCREEN_SIZE; screen_size < size && lod_index < lod_count; size *= MESH_LOD_SCREEN_SIZE_STEP)
+        lod_index++;
+    return lod_index;
+}
+
+// Size in pixels of a sphere seen from the given distance, where a pixel subtends pixel_angle (at unit distance):
+INLINE_XPU f32 getScreenSize(f32 radius, f32 distance, f32 pixel_angle) {
+    return distance > radius ? 2.0f * radius / (distance * pixel_angle) : INFINITY;
+}
 
 struct Triangle {
     mat3 local_to_tangent;
@@ -516,6 +556,11 @@ struct Mesh {
 
     EdgeVertexIndices *edge_vertex_indices{nullptr};
 
+    // Simplified versions of the mesh (coarsest last), sharing its vertices and bounds but having their own
+    // triangles, indices and BVH (and no edges):
+    Mesh *lods{nullptr};
+    u32 lod_count{0};
+
     u32 triangle_count{0};
     u32 vertex_count{0};
     u32 edge_count{0};
@@ -523,6 +568,9 @@ struct Mesh {
     u32 tangents_count{0};
     u32 uvs_count{0};
 
+    // Changes whenever the vertex positions are (re)written in place, see positionsChanged():
+    u64 version{0};
+
     Mesh() = default;
 
     Mesh(u32 triangle_count,
@@ -566,6 +614,36 @@ struct Mesh {
             aabb{aabb}
     {}
 
+    // LOD 0 is the mesh itself:
+    INLINE_XPU const Mesh& lod(u32 lod_index) const { return lod_index ? lods[lod_index - 1] : *this; }
+
+    // Gives the mesh a version no other mesh had, so anything cached from its positions gets recomputed:
+    void positionsChanged() {
+        static u64 last_version = 0;
+        version = ++last_version;
+    }
+
+    INLINE_XPU f32 boundingRadius() const { return (aabb.max - aabb.min).length() * 0.5f; }
+
+    // A LOD of the mesh with room for the given number of triangles (its triangles, indices and BVH nodes are
+    // left for the caller to allocate):
+    Mesh makeLOD(u32 max_triangle_count) const {
+        Mesh lod;
+        lod.aabb = aabb;
+        lod.bvh = BVH{};
+        lod.triangles = nullptr;
+        lod.triangle_count = max_triangle_count;
+        lod.vertex_count   = vertex_count;
+        lod.normals_count  = normals_count;
+        lod.tangents_count = tangents_count;
+        lod.uvs_count      = uvs_count;
+        lod.vertex_positions = vertex_positions;
+        lod.vertex_normals   = vertex_normals;
+        lod.vertex_tangents  = vertex_tangents;
+        lod.vertex_uvs       = vertex_uvs;
+        return lod;
+    }
+
     void loadEdges(Edge *edges) const {
         EdgeVertexIndices *ids = edge_vertex_indices;
         for (u32 edge_index = 0; edge_index < edge_count; edge_index++, ids++)
@@ -654,4 +732,20 @@ struct Mesh {
         bvh.node_count = 11;
         bvh.height = 5;
     }
-};
\ No newline at end of file
+};
+
+// Picks the LOD of each mesh geometry by its size on screen (see getLODIndex) as seen from view_position, where a
+// pixel subtends pixel_angle. Other geometries get LOD 0:
+void setGeometryLODs(const Geometry *geometries, u32 geometry_count, const Mesh *meshes,
+                     const vec3 &view_position, f32 pixel_angle, u8 *geometry_lods) {
+    for (u32 i = 0; i < geometry_count; i++) {
+        const Geometry &geo{geometries[i]};
+        geometry_lods[i] = 0;
+        if (geo.type != GeometryType_Mesh) continue;
+
+        const Mesh &mesh{meshes[geo.id]};
+        const f32 radius = mesh.boundingRadius() * geo.transform.scale.maximum();
+        const f32 distance = (geo.transform.position - view_position).length();
+        geometry_lods[i] = (u8)getLODIndex(mesh.lod_count, getScreenSize(radius, distance, pixel_angle));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <string.h>
+
+#include "./mesh.h"
+#include "../core/radix_sort.h"
+
+// Offline reordering of a mesh's triangles and vertices for the rasterizer:
+// Triangles are ordered for the post-transform vertex cache (Forsyth's linear-speed optimizer), optionally
+// followed by ordering clusters of them for less overdraw (as in Sander et al. 2007), then vertices are
+// ordered by first use for fetch locality. Positions stand in for rasterized vertices throughout.
+// Tangents are not reordered, as they are derived from the other attributes (after reordering).
+#define VERTEX_CACHE_SIZE 32
+#define VERTEX_CACHE_SIMULATION_SIZE 16
+#define OVERDRAW_MIN_CLUSTER_SIZE 64
+#define OVERDRAW_CACHE_THRESHOLD 1.05f
+
+// Average cache miss ratio: Vertices transformed per triangle by a FIFO post-transform cache (0.5 to 3):
+f32 getACMR(const TriangleVertexIndices *indices, u32 triangle_count, u32 vertex_count, u32 cache_size = VERTEX_CACHE_SIMULATION_SIZE) {
+    if (!triangle_count) return 0;
+
+    // A vertex is cached while fewer than cache_size misses happened since it was last loaded:
+    u32 *load_times = new u32[vertex_count];
+    for (u32 i = 0; i < vertex_count; i++) load_times[i] = 0;
+
+    u32 miss_count = 0;
+    for (u32 t = 0; t < triangle_count; t++)
+        for (u8 i = 0; i < 3; i++) {
+            u32 v = indices[t].ids[i];
+            if (!load_times[v] || miss_count - load_times[v] >= cache_size)
+                load_times[v] = ++miss_count;
+        }
+    delete[] load_times;
+
+    return (f32)miss_count / (f32)triangle_count;
+}
+
+INLINE f32 getVertexCacheScore(i32 cache_position, u32 remaining_triangle_count) {
+    if (!remaining_triangle_count) return -1.0f;
+
+    f32 score = 0;
+    if (cache_position >= 0) {
+        // The last triangle's vertices score the same, so that its neighbours are not favoured by direction:
+        if (cache_position < 3) score = 0.75f;
+        else score = powf(1.0f - (f32)(cache_position - 3) / (f32)(VERTEX_CACHE_SIZE - 3), 1.5f);
+    }
+    // Vertices with few triangles left are preferred, to be done with them early:
+    return score + 2.0f / sqrtf((f32)remaining_triangle_count);
+}
+
+void optimizeVertexCache(const TriangleVertexIndices *indices, u32 triangle_count, u32 vertex_count, u32 *triangle_order) {
+    if (!triangle_count) return;
+
+    // The triangles of each vertex, the ones that are not emitted yet kept at the front of its range:
+    u32 *first_vertex_triangles = new u32[vertex_count + 1];
+    u32 *remaining_triangle_counts = new u32[vertex_count];
+    u32 *vertex_triangles = new u32[triangle_count * 3];
+    for (u32 v = 0; v < vertex_count; v++) remaining_triangle_counts[v] = 0;
+    for (u32 t = 0; t < triangle_count; t++)
+        for (u8 i = 0; i < 3; i++) remaining_triangle_counts[indices[t].ids[i]]++;
+
+    first_vertex_triangles[0] = 0;
+    for (u32 v = 0; v < vertex_count; v++) first_vertex_triangles[v + 1] = first_vertex_triangles[v] + remaining_triangle_counts[v];
+    for (u32 v = 0; v < vertex_count; v++) remaining_triangle_counts[v] = 0;
+    for (u32 t = 0; t < triangle_count; t++)
+        for (u8 i = 0; i < 3; i++) {
+            u32 v = indices[t].ids[i];
+            vertex_triangles[first_vertex_triangles[v] + remaining_triangle_counts[v]++] = t;
+        }
+
+    f32 *vertex_scores = new f32[vertex_count];
+    for (u32 v = 0; v < vertex_count; v++) vertex_scores[v] = getVertexCacheScore(-1, remaining_triangle_counts[v]);
+
+    f32 *triangle_scores = new f32[triangle_count];
+    bool *emitted = new bool[triangle_count];
+    u32 best_triangle = 0;
+    for (u32 t = 0; t < triangle_count; t++) {
+        emitted[t] = false;
+        triangle_scores[t] = 0;
+        for (u8 i = 0; i < 3; i++) triangle_scores[t] += vertex_scores[indices[t].ids[i]];
+        if (triangle_scores[t] > triangle_scores[best_triangle]) best_triangle = t;
+    }
+
+    u32 cache[VERTEX_CACHE_SIZE + 3];
+    u32 new_cache[VERTEX_CACHE_SIZE + 3];
+    u32 cache_size = 0;
+    u32 next_unemitted = 0;
+    for (u32 emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+        triangle_order[emitted_count] = best_triangle;
+        emitted[best_triangle] = true;
+
+        // The emitted triangle's vertices move to the front of the cache and lose the triangle:
+        const u32 *triangle_vertices = indices[best_triangle].ids;
+        u32 new_cache_size = 0;
+        for (u8 i = 0; i < 3; i++) {
+            u32 v = triangle_vertices[i];
+            u32 *triangles = vertex_triangles + first_vertex_triangles[v];
+            u32 &remaining_triangle_count = remaining_triangle_counts[v];
+            for (u32 j = 0; j < remaining_triangle_count; j++)
+                if (triangles[j] == best_triangle) {
+                    triangles[j] = triangles[--remaining_triangle_count];
+                    triangles[remaining_triangle_count] = best_triangle;
+                    break;
+                }
+
+            bool repeated = false;
+            for (u32 j = 0; j < new_cache_size; j++) if (new_cache[j] == v) repeated = true;
+            if (!repeated) new_cache[new_cache_size++] = v;
+        }
+        for (u32 j = 0; j < cache_size; j++) {
+            u32 v = cache[j];
+            if (v != triangle_vertices[0] && v != triangle_vertices[1] && v != triangle_vertices[2])
+                new_cache[new_cache_size++] = v;
+        }
+
+        // Rescore the vertices that were or are cached and the triangles they have left:
+        for (u32 j = 0; j < new_cache_size; j++) {
+            u32 v = new_cache[j];
+            const f32 score = getVertexCacheScore(j < VERTEX_CACHE_SIZE ? (i32)j : -1, remaining_triangle_counts[v]);
+            const f32 score_delta = score - vertex_scores[v];
+            vertex_scores[v] = score;
+
+            const u32 *triangles = vertex_triangles + first_vertex_triangles[v];
+            for (u32 k = 0; k < remaining_triangle_counts[v]; k++) triangle_scores[triangles[k]] += score_delta;
+        }
+        cache_size = Min(new_cache_size, (u32)VERTEX_CACHE_SIZE);
+
+        // Then (with all of their scores final) pick the best of the cached vertices' triangles to emit next:
+        best_triangle = INVALID_VERTEX_INDEX;
+        f32 best_score = -1.0f;
+        for (u32 j = 0; j < cache_size; j++) {
+            u32 v = new_cache[j];
+            const u32 *triangles = vertex_triangles + first_vertex_triangles[v];
+            for (u32 k = 0; k < remaining_triangle_counts[v]; k++) {
+                u32 t = triangles[k];
+                if (triangle_scores[t] > best_score) {
+                    best_score = triangle_scores[t];
+                    best_triangle = t;
+                }
+            }
+        }
+        for (u32 j = 0; j < cache_size; j++) cache[j] = new_cache[j];
+
+        // When no cached vertex has triangles left, continue from the first triangle not emitted yet:
+        if (best_triangle == INVALID_VERTEX_INDEX) {
+            while (next_unemitted < triangle_count && emitted[next_unemitted]) next_unemitted++;
+            best_triangle = next_unemitted;
+        }
+    }
+
+    delete[] first_vertex_triangles;
+    delete[] remaining_triangle_counts;
+    delete[] vertex_triangles;
+    delete[] vertex_scores;
+    delete[] triangle_scores;
+    delete[] emitted;
+}
+
+// Maps a float to a u32 that sorts in the same order:
+INLINE u32 getSortableBits(f32 value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
+// Splits the cache-optimized triangle order into clusters where the cache restarts (all 3 vertices missing)
+// or where a cluster's own ACMR is back within OVERDRAW_CACHE_THRESHOLD of the whole mesh's, then orders the
+// clusters facing most outwards from the mesh's center first, as these are the most likely to occlude the
+// rest. Clusters keep their triangles' order, so cache efficiency is mostly preserved:
+void optimizeOverdraw(const Mesh &mesh, u32 *triangle_order) {
+    const TriangleVertexIndices *indices = mesh.vertex_position_indices;
+    const vec3 *positions = mesh.vertex_positions;
+    const u32 triangle_count = mesh.triangle_count;
+    if (!triangle_count) return;
+
+    u32 *cluster_starts = new u32[triangle_count + 1];
+    u32 cluster_count = 0;
+    {
+        auto *ordered_indices = new TriangleVertexIndices[triangle_count];
+        for (u32 i = 0; i < triangle_count; i++) ordered_indices[i] = indices[triangle_order[i]];
+        const f32 threshold = OVERDRAW_CACHE_THRESHOLD * getACMR(ordered_indices, triangle_count, mesh.vertex_count);
+        delete[] ordered_indices;
+
+        u32 *load_times = new u32[mesh.vertex_count];
+        for (u32 i = 0; i < mesh.vertex_count; i++) load_times[i] = 0;
+
+        u32 miss_count = 0;
+        u32 cluster_miss_count = 0;
+        for (u32 i = 0; i < triangle_count; i++) {
+            u8 triangle_miss_count = 0;
+            for (u8 j = 0; j < 3; j++) {
+                u32 v = indices[triangle_order[i]].ids[j];
+                if (!load_times[v] || miss_count - load_times[v] >= VERTEX_CACHE_SIMULATION_SIZE) {
+                    load_times[v] = ++miss_count;
+                    triangle_miss_count++;
+                }
+            }
+            u32 cluster_size = cluster_count ? i - cluster_starts[cluster_count - 1] : 0;
+            if (!cluster_count || (cluster_size >= OVERDRAW_MIN_CLUSTER_SIZE &&
+                                   (triangle_miss_count == 3 || (f32)cluster_miss_count <= threshold * (f32)cluster_size))) {
+                cluster_starts[cluster_count++] = i;
+                cluster_miss_count = 0;
+            }
+            cluster_miss_count += triangle_miss_count;
+        }
+        cluster_starts[cluster_count] = triangle_count;
+        delete[] load_times;
+    }
+
+    vec3 mesh_center{0.0f};
+    for (u32 v = 0; v < mesh.vertex_count; v++) mesh_center += positions[v];
+    mesh_center /= (f32)Max(mesh.vertex_count, 1u);
+
+    // Sort keys: How much a cluster faces outwards (descending) then its index (ascending):
+    u64 *keys = new u64[cluster_count * 2];
+    for (u32 c = 0; c < cluster_count; c++) {
+        vec3 cluster_center{0.0f};
+        vec3 cluster_normal{0.0f};
+        f32 cluster_area = 0;
+        for (u32 i = cluster_starts[c]; i < cluster_starts[c + 1]; i++) {
+            const u32 *ids = indices[triangle_order[i]].ids;
+            const vec3 &v1 = positions[ids[0]];
+            const vec3 &v2 = positions[ids[1]];
+            const vec3 &v3 = positions[ids[2]];
+            vec3 normal = (v2 - v1).cross(v3 - v1);
+            f32 area = normal.length();
+            cluster_normal += normal;
+            cluster_center += (v1 + v2 + v3) * (area / 3.0f);
+            cluster_area += area;
+        }
+        if (cluster_area > 0) cluster_center /= cluster_area;
+        f32 length = cluster_normal.length();
+        if (length > 0) cluster_normal /= length;
+
+        f32 outwardness = (cluster_center - mesh_center).dot(cluster_normal);
+        keys[c] = ((u64)~getSortableBits(outwardness) << 32) | c;
+    }
+    const u64 *sorted_keys = radixSort(keys, keys + cluster_count, cluster_count, 64);
+
+    u32 *new_order = new u32[triangle_count];
+    u32 *new_triangle = new_order;
+    for (u32 i = 0; i < cluster_count; i++) {
+        u32 c = (u32)(sorted_keys[i] & 0xFFFFFFFF);
+        for (u32 t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) *(new_triangle++) = triangle_order[t];
+    }
+    for (u32 t = 0; t < triangle_count; t++) triangle_order[t] = new_order[t];
+
+    delete[] new_order;
+    delete[] keys;
+    delete[] cluster_starts;
+}
+
+void reorderTriangles(TriangleVertexIndices *indices, u32 triangle_count, const u32 *triangle_order, TriangleVertexIndices *scratch) {
+    if (!indices) return;
+    for (u32 t = 0; t < triangle_count; t++) scratch[t] = indices[triangle_order[t]];
+    for (u32 t = 0; t < triangle_count; t++) indices[t] = scratch[t];
+}
+
+void reorderTriangles(Mesh &mesh, const u32 *triangle_order) {
+    auto *scratch = new TriangleVertexIndices[mesh.triangle_count];
+    reorderTriangles(mesh.vertex_position_indices, mesh.triangle_count, triangle_order, scratch);
+    if (mesh.uvs_count)      reorderTriangles(mesh.vertex_uvs_indices,     mesh.triangle_count, triangle_order, scratch);
+    if (mesh.normals_count)  reorderTriangles(mesh.vertex_normal_indices,  mesh.triangle_count, triangle_order, scratch);
+    delete[] scratch;
+}
+
+// Reorders an attribute's values by their first use in triangle order (unused ones go last):
+template <typename T>
+void reorderVertices(T *values, u32 value_count, TriangleVertexIndices *indices, u32 triangle_count) {
+    if (!values || !indices || !value_count) return;
+
+    u32 *new_indices = new u32[value_count];
+    for (u32 i = 0; i < value_count; i++) new_indices[i] = INVALID_VERTEX_INDEX;
+
+    u32 used_count = 0;
+    for (u32 t = 0; t < triangle_count; t++)
+        for (u8 i = 0; i < 3; i++) {
+            u32 &index = indices[t].ids[i];
+            if (new_indices[index] == INVALID_VERTEX_INDEX) new_indices[index] = used_count++;
+            index = new_indices[index];
+        }
+    for (u32 i = 0; i < value_count; i++)
+        if (new_indices[i] == INVALID_VERTEX_INDEX) new_indices[i] = used_count++;
+
+    T *new_values = new T[value_count];
+    for (u32 i = 0; i < value_count; i++) new_values[new_indices[i]] = values[i];
+    for (u32 i = 0; i < value_count; i++) values[i] = new_values[i];
+
+    delete[] new_values;
+    delete[] new_indices;
+}
+
+void reorderVertices(Mesh &mesh) {
+    reorderVertices(mesh.vertex_positions, mesh.vertex_count,    mesh.vertex_position_indices, mesh.triangle_count);
+    reorderVertices(mesh.vertex_uvs,       mesh.uvs_count,       mesh.vertex_uvs_indices,      mesh.triangle_count);
+    reorderVertices(mesh.vertex_normals,   mesh.normals_count,   mesh.vertex_normal_indices,   mesh.triangle_count);
+}
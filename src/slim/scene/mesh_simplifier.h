@@ -0,0 +1,261 @@
+#pragma once
+
+#include "./mesh_optimizer.h"
+
+// Offline simplification of a mesh's triangles for its LODs, by collapsing edges in the order of their quadric
+// error (Garland & Heckbert 1997). An edge collapses onto one of its 2 vertices rather than a new position, so
+// LODs keep indexing into the mesh's own vertices. Vertices on borders or on uv/normal seams are never removed.
+// Collapses happen in passes: Each pass sorts the candidate collapses by error and performs them cheapest first,
+// skipping those that involve a vertex already involved in a collapse during the pass (whose error is stale).
+#define MESH_SIMPLIFICATION_MAX_PASSES 64
+#define MESH_SIMPLIFICATION_MAX_VALENCE 32
+#define MESH_SIMPLIFICATION_MIN_NORMAL_DOT 0.2f
+
+#define MESH_SIMPLIFICATION_VERTEX_IS_LOCKED  1
+#define MESH_SIMPLIFICATION_VERTEX_IS_TOUCHED 2
+
+// Sum of squared distances to a set of planes, as a symmetric 4x4 matrix:
+struct Quadric {
+    f64 xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+
+    INLINE void setPlane(const vec3 &normal, f32 distance) {
+        const f64 x = normal.x, y = normal.y, z = normal.z, w = distance;
+        xx = x * x; xy = x * y; xz = x * z; xw = x * w;
+        yy = y * y; yz = y * z; yw = y * w;
+        zz = z * z; zw = z * w;
+        ww = w * w;
+    }
+
+    INLINE void add(const Quadric &other) {
+        xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+        yy += other.yy; yz += other.yz; yw += other.yw;
+        zz += other.zz; zw += other.zw;
+        ww += other.ww;
+    }
+
+    INLINE f64 evaluate(const Quadric &other, const vec3 &p) const {
+        const f64 x = p.x, y = p.y, z = p.z;
+        return (xx + other.xx) * x * x + (yy + other.yy) * y * y + (zz + other.zz) * z * z + (ww + other.ww) +
+               2 * ((xy + other.xy) * x * y + (xz + other.xz) * x * z + (yz + other.yz) * y * z +
+                    (xw + other.xw) * x + (yw + other.yw) * y + (zw + other.zw) * z);
+    }
+};
+
+INLINE u8 getNextCorner(u8 corner) { return corner == 2 ? 0 : corner + 1; }
+
+INLINE bool hasVertex(const TriangleVertexIndices &indices, u32 vertex) {
+    return indices.v1 == vertex || indices.v2 == vertex || indices.v3 == vertex;
+}
+
+// Whether removing vertex a by moving it onto vertex b keeps the surface manifold (the vertices adjacent to both
+// are the ones opposite the edge) and flips none of the triangles around a that remain:
+bool canCollapse(u32 a, u32 b, const TriangleVertexIndices *indices, const vec3 *positions, const u8 *alive,
+                 const u32 *first_corners, const u32 *corners) {
+    u32 a_neighbors[MESH_SIMPLIFICATION_MAX_VALENCE * 2];
+    u32 a_neighbor_count = 0;
+    u32 shared_triangle_count = 0;
+    for (u32 c = first_corners[a]; c < first_corners[a + 1]; c++) {
+        const u32 t = corners[c] / 3;
+        if (!alive[t]) continue;
+
+        const TriangleVertexIndices &triangle = indices[t];
+        if (hasVertex(triangle, b)) {
+            shared_triangle_count++;
+        } else {
+            const u8 i = (u8)(corners[c] % 3);
+            const vec3 &p1 = positions[triangle.ids[getNextCorner(i)]];
+            const vec3 &p2 = positions[triangle.ids[getNextCorner(getNextCorner(i))]];
+            const vec3 old_normal = (p1 - positions[a]).cross(p2 - positions[a]);
+            const vec3 new_normal = (p1 - positions[b]).cross(p2 - positions[b]);
+            const f32 old_length = old_normal.length();
+            const f32 new_length = new_normal.length();
+            if (new_length <= EPS * old_length ||
+                old_normal.dot(new_normal) < MESH_SIMPLIFICATION_MIN_NORMAL_DOT * old_length * new_length)
+                return false;
+        }
+
+        for (u8 j = 0; j < 3; j++) {
+            const u32 v = triangle.ids[j];
+            if (v == a || v == b) continue;
+
+            u32 n = 0;
+            while (n < a_neighbor_count && a_neighbors[n] != v) n++;
+            if (n == a_neighbor_count) {
+                if (a_neighbor_count == MESH_SIMPLIFICATION_MAX_VALENCE * 2) return false;
+                a_neighbors[a_neighbor_count++] = v;
+            }
+        }
+    }
+
+    u32 shared_neighbor_count = 0;
+    for (u32 n = 0; n < a_neighbor_count; n++)
+        for (u32 c = first_corners[b]; c < first_corners[b + 1]; c++) {
+            const u32 t = corners[c] / 3;
+            if (alive[t] && hasVertex(indices[t], a_neighbors[n])) {
+                shared_neighbor_count++;
+                break;
+            }
+        }
+
+    return shared_neighbor_count == shared_triangle_count;
+}
+
+// Simplifies the source mesh's (or LOD's) triangles into the given LOD, down to about target_triangle_count.
+// The LOD's index arrays need room for as many triangles as the source has. Returns the largest error of a
+// collapse (as a distance):
+f32 simplifyMesh(const Mesh &source, Mesh &lod, u32 target_triangle_count) {
+    const u32 vertex_count = source.vertex_count;
+    const u32 triangle_count = source.triangle_count;
+    TriangleVertexIndices *indices = lod.vertex_position_indices;
+    TriangleVertexIndices *attributes[3] = {
+        source.uvs_count     ? lod.vertex_uvs_indices     : nullptr,
+        source.normals_count ? lod.vertex_normal_indices  : nullptr,
+        source.tangents_count ? lod.vertex_tangent_indices : nullptr
+    };
+    const TriangleVertexIndices *source_attributes[3] = {
+        source.vertex_uvs_indices,
+        source.vertex_normal_indices,
+        source.vertex_tangent_indices
+    };
+    for (u32 t = 0; t < triangle_count; t++) {
+        indices[t] = source.vertex_position_indices[t];
+        for (u8 a = 0; a < 3; a++) if (attributes[a]) attributes[a][t] = source_attributes[a][t];
+    }
+
+    const vec3 *positions = source.vertex_positions;
+    Quadric *quadrics = new Quadric[vertex_count];
+    for (u32 v = 0; v < vertex_count; v++) quadrics[v] = Quadric{};
+    for (u32 t = 0; t < triangle_count; t++) {
+        const vec3 &p1 = positions[indices[t].v1];
+        vec3 normal = (positions[indices[t].v2] - p1).cross(positions[indices[t].v3] - p1);
+        const f32 length = normal.length();
+        if (length == 0) continue;
+
+        normal /= length;
+        Quadric plane;
+        plane.setPlane(normal, -normal.dot(p1));
+        for (u8 i = 0; i < 3; i++) quadrics[indices[t].ids[i]].add(plane);
+    }
+
+    u8 *alive = new u8[triangle_count];
+    u8 *vertex_flags = new u8[vertex_count];
+    u32 *first_corners = new u32[vertex_count + 1];
+    u32 *corners = new u32[triangle_count * 3]; // As triangle * 3 + corner, grouped by vertex
+    u64 *keys = new u64[triangle_count * 3];
+    u64 *scratch = new u64[triangle_count * 3];
+    for (u32 t = 0; t < triangle_count; t++) alive[t] = 1;
+    for (u32 v = 0; v < vertex_count; v++) vertex_flags[v] = 0;
+
+    u32 alive_count = triangle_count;
+    f64 max_error = 0;
+    for (u32 pass = 0; pass < MESH_SIMPLIFICATION_MAX_PASSES && alive_count > target_triangle_count; pass++) {
+        // Group the corners of the remaining triangles by vertex. This stays valid during the pass for vertices
+        // that are not touched by it, as collapses only delete their triangles or move their neighbours:
+        for (u32 v = 0; v <= vertex_count; v++) first_corners[v] = 0;
+        for (u32 t = 0; t < triangle_count; t++)
+            if (alive[t]) for (u8 i = 0; i < 3; i++) first_corners[indices[t].ids[i] + 1]++;
+        for (u32 v = 0; v < vertex_count; v++) first_corners[v + 1] += first_corners[v];
+        for (u32 t = 0; t < triangle_count; t++)
+            if (alive[t]) for (u8 i = 0; i < 3; i++) corners[first_corners[indices[t].ids[i]]++] = t * 3 + i;
+        for (u32 v = vertex_count; v; v--) first_corners[v] = first_corners[v - 1];
+        first_corners[0] = 0;
+
+        if (!pass) {
+            // Lock vertices on seams (having different uvs or normals on different triangles), and both vertices
+            // of border edges (having no twin going the other way):
+            for (u32 v = 0; v < vertex_count; v++)
+                for (u32 c = first_corners[v] + 1; c < first_corners[v + 1]; c++)
+                    for (u8 a = 0; a < 2; a++)
+                        if (attributes[a] && attributes[a][corners[c] / 3].ids[corners[c] % 3] !=
+                                             attributes[a][corners[first_corners[v]] / 3].ids[corners[first_corners[v]] % 3])
+                            vertex_flags[v] = MESH_SIMPLIFICATION_VERTEX_IS_LOCKED;
+
+            for (u32 v = 0; v < vertex_count; v++)
+                for (u32 c = first_corners[v]; c < first_corners[v + 1]; c++) {
+                    const u32 next = indices[corners[c] / 3].ids[getNextCorner((u8)(corners[c] % 3))];
+                    bool has_twin = false;
+                    for (u32 n = first_corners[next]; n < first_corners[next + 1] && !has_twin; n++)
+                        has_twin = indices[corners[n] / 3].ids[getNextCorner((u8)(corners[n] % 3))] == v;
+                    if (!has_twin) vertex_flags[v] = vertex_flags[next] = MESH_SIMPLIFICATION_VERTEX_IS_LOCKED;
+                }
+        }
+        for (u32 v = 0; v < vertex_count; v++) vertex_flags[v] &= ~MESH_SIMPLIFICATION_VERTEX_IS_TOUCHED;
+
+        // Each corner stands for collapsing its vertex onto the next one of its triangle:
+        u32 candidate_count = 0;
+        for (u32 t = 0; t < triangle_count; t++) {
+            if (!alive[t]) continue;
+            for (u8 i = 0; i < 3; i++) {
+                const u32 a = indices[t].ids[i];
+                if (vertex_flags[a] & MESH_SIMPLIFICATION_VERTEX_IS_LOCKED) continue;
+
+                const u32 b = indices[t].ids[getNextCorner(i)];
+                const f32 error = (f32)Max(quadrics[a].evaluate(quadrics[b], positions[b]), 0.0);
+                keys[candidate_count++] = (u64)getSortableBits(error) << 32 | (u64)(t * 3 + i);
+            }
+        }
+        const u64 *sorted_keys = radixSort(keys, scratch, candidate_count, 64);
+
+        u32 collapse_count = 0;
+        for (u32 k = 0; k < candidate_count && alive_count > target_triangle_count; k++) {
+            const u32 t = (u32)(sorted_keys[k] & 0xFFFFFFFF) / 3;
+            const u8 i = (u8)((sorted_keys[k] & 0xFFFFFFFF) % 3);
+            if (!alive[t]) continue;
+
+            const u8 j = getNextCorner(i);
+            const u32 a = indices[t].ids[i];
+            const u32 b = indices[t].ids[j];
+            if ((vertex_flags[a] | vertex_flags[b]) & MESH_SIMPLIFICATION_VERTEX_IS_TOUCHED ||
+                !canCollapse(a, b, indices, positions, alive, first_corners, corners))
+                continue;
+
+            max_error = Max(max_error, quadrics[a].evaluate(quadrics[b], positions[b]));
+
+            // The corners of a take on the attributes b has in this triangle (a is on no seam, so they all had
+            // the same uvs and normals):
+            u32 b_attributes[3];
+            for (u8 attribute = 0; attribute < 3; attribute++)
+                if (attributes[attribute]) b_attributes[attribute] = attributes[attribute][t].ids[j];
+
+            for (u32 c = first_corners[a]; c < first_corners[a + 1]; c++) {
+                const u32 s = corners[c] / 3;
+                if (!alive[s]) continue;
+                if (hasVertex(indices[s], b)) {
+                    alive[s] = 0;
+                    alive_count--;
+                    continue;
+                }
+
+                const u8 corner = (u8)(corners[c] % 3);
+                indices[s].ids[corner] = b;
+                for (u8 attribute = 0; attribute < 3; attribute++)
+                    if (attributes[attribute]) attributes[attribute][s].ids[corner] = b_attributes[attribute];
+            }
+            quadrics[b].add(quadrics[a]);
+            vertex_flags[a] |= MESH_SIMPLIFICATION_VERTEX_IS_TOUCHED;
+            vertex_flags[b] |= MESH_SIMPLIFICATION_VERTEX_IS_TOUCHED;
+            collapse_count++;
+        }
+        if (!collapse_count) break;
+    }
+
+    // Pack the remaining triangles, keeping their order:
+    u32 lod_triangle_count = 0;
+    for (u32 t = 0; t < triangle_count; t++) {
+        if (!alive[t]) continue;
+        indices[lod_triangle_count] = indices[t];
+        for (u8 a = 0; a < 3; a++) if (attributes[a]) attributes[a][lod_triangle_count] = attributes[a][t];
+        lod_triangle_count++;
+    }
+    lod.triangle_count = lod_triangle_count;
+
+    delete[] quadrics;
+    delete[] alive;
+    delete[] vertex_flags;
+    delete[] first_corners;
+    delete[] corners;
+    delete[] keys;
+    delete[] scratch;
+
+    return sqrtf((f32)max_error);
+}
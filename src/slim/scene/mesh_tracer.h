@@ -2,6 +2,31 @@
 
 #include "./mesh.h"
 #include "../core/ray.h"
+#include "../core/texture.h"
+
+// UV-space axes of a ray cone's footprint on a triangle (for Texture::sampleAnisotropic): The cone's circular
+// cross-section (cone_width across at the hit) stretches by 1/|N.Rd| along the ray's projection onto the triangle.
+// The ray direction and the cone width are expected in the triangle's (mesh-local) space:
+INLINE_XPU void getUVFootprint(const Triangle &triangle, const vec3 &ray_direction, f32 cone_width,
+                               vec2 &major_axis, vec2 &minor_axis) {
+    const vec3 direction = ray_direction.normalized();
+    const f32 NdotRd = triangle.normal.dot(direction);
+    const f32 cos_theta = Max(fabsf(NdotRd), 1.0f / TEXTURE_MAX_ANISOTROPY);
+
+    vec3 minor = triangle.normal.cross(direction);
+    if (minor.squaredLength() < EPS) // Head-on: Any pair of in-plane directions will do
+        minor = triangle.normal.cross(fabsf(triangle.normal.x) < 0.9f ? vec3{1, 0, 0} : vec3{0, 1, 0});
+    minor = minor.normalized();
+    const vec3 major = minor.cross(triangle.normal);
+
+    // Positions map to barycentric coordinates of uv3 (x) and uv2 (y) through local_to_tangent:
+    const vec2 uv3_edge = triangle.uv3 - triangle.uv1;
+    const vec2 uv2_edge = triangle.uv2 - triangle.uv1;
+    const vec3 major_barycentric = triangle.local_to_tangent * (major * (cone_width / cos_theta));
+    const vec3 minor_barycentric = triangle.local_to_tangent * (minor * cone_width);
+    major_axis = uv3_edge * major_barycentric.x + uv2_edge * major_barycentric.y;
+    minor_axis = uv3_edge * minor_barycentric.x + uv2_edge * minor_barycentric.y;
+}
 
 struct MeshTracer {
     u32 *stack = nullptr;
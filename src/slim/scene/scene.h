@@ -11,6 +11,7 @@
 #include "../core/ray.h"
 #include "../core/transform.h"
 #include "../serialization/texture.h"
+#include "../serialization/texture_streaming.h"
 #include "../serialization/mesh.h"
 
 struct SceneCountsData {
@@ -111,7 +112,8 @@ struct Scene : SceneData {
         Curve *curves = nullptr,
         SceneIO *scene_io = nullptr,
         
-        memory::MonotonicAllocator *memory_allocator = nullptr
+        memory::MonotonicAllocator *memory_allocator = nullptr,
+        TextureStreamer *texture_streamer = nullptr
     ) : SceneData{
         counts, 0, 0,
         geometries, 
@@ -143,12 +145,16 @@ struct Scene : SceneData {
 
         if (counts.textures) {
             if (!textures) capacity += sizeof(Texture) * counts.textures;
-            capacity += getTotalMemoryForTextures(texture_files, counts.textures);
+            capacity += texture_streamer ?
+                getTotalMemoryForStreamedTextures(texture_files, counts.textures) :
+                getTotalMemoryForTextures(texture_files, counts.textures);
         }
         u32 max_triangle_count = 0;
+        ContainerView *mapped_mesh_files = nullptr;
         if (counts.meshes) {
             if (!meshes) capacity += sizeof(Mesh) * counts.meshes;
-            capacity += getTotalMemoryForMeshes(mesh_files, counts.meshes, &max_triangle_count, &bvh_nodes_capacity);
+            if (mesh_files) mapped_mesh_files = (ContainerView*)os::getMemory(sizeof(ContainerView) * counts.meshes);
+            capacity += getTotalMemoryForMeshes(mesh_files, counts.meshes, &max_triangle_count, &bvh_nodes_capacity, mapped_mesh_files);
             capacity += sizeof(u32) * (2 * counts.meshes);
         }
         u32 max_leaf_node_count = Max(max_triangle_count, counts.geometries);
@@ -200,17 +206,21 @@ struct Scene : SceneData {
         if (counts.textures && texture_files) {
             if (!textures) textures = (Texture*)memory_allocator->allocate(sizeof(Texture) * counts.textures);
             for (u32 i = 0; i < counts.textures; i++)
-                load(textures[i], texture_files[i].char_ptr, memory_allocator);
+                if (texture_streamer) texture_streamer->add(textures[i], texture_files[i].char_ptr, memory_allocator);
+                else load(textures[i], texture_files[i].char_ptr, memory_allocator);
         }
         if (counts.meshes && mesh_files) {
             if (!meshes) meshes = (Mesh*)memory_allocator->allocate(sizeof(Mesh) * counts.meshes);
             for (u32 i = 0; i < counts.meshes; i++) meshes[i] = Mesh{};
 
             for (u32 i = 0; i < counts.meshes; i++) {
-                load(meshes[i], mesh_files[i].char_ptr, memory_allocator, &bvh_nodes_allocator);
-                mesh_stack_size = Max(mesh_stack_size, meshes[i].bvh.height);
+                if (mapped_mesh_files[i].memory) map(meshes[i], mapped_mesh_files[i], memory_allocator);
+                else load(meshes[i], mesh_files[i].char_ptr, memory_allocator, &bvh_nodes_allocator);
+                for (u32 l = 0; l <= meshes[i].lod_count; l++)
+                    mesh_stack_size = Max(mesh_stack_size, meshes[i].lod(l).bvh.height);
             }
             mesh_stack_size += 2;
+            os::freeMemory(mapped_mesh_files);
         }
 
         for (u32 i = 0; i < counts.geometries; i++)
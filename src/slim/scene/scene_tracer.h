@@ -9,6 +9,7 @@ struct SceneTracer {
     u32 *stack{nullptr};
     Ray aux_ray;
     RayHit aux_hit;
+    u8 *geometry_lods{nullptr}; // Picked for each geometry by setLODs (meshes are traced at full detail while null)
 
     INLINE_XPU SceneTracer(u32 *stack, u32 *mesh_stack) : mesh_tracer{mesh_stack}, stack{stack} {}
 
@@ -23,6 +24,15 @@ struct SceneTracer {
         mesh_tracer = MeshTracer{mesh_stack_size, memory_allocator};
     }
 
+    // Picks the LOD of each mesh geometry by its size on screen as seen through the given camera (call once per
+    // frame). All rays then trace the same LOD, so that secondary and shadow rays hit the surface that was shaded:
+    void setLODs(const Scene &scene, const Camera &camera, const Dimensions &dimensions) {
+        if (!geometry_lods) geometry_lods = new u8[scene.counts.geometries];
+
+        const f32 pixel_angle = 1.0f / (dimensions.h_height * camera.focal_length);
+        setGeometryLODs(scene.geometries, scene.counts.geometries, scene.meshes, camera.position, pixel_angle, geometry_lods);
+    }
+
     XPU Geometry* trace(Ray &ray, RayHit &hit, const Scene &scene, bool any_hit = false, f32 max_distance = INFINITY) {
         ray.reset(ray.direction.scaleAdd(TRACE_OFFSET, ray.origin), ray.direction);
         hit.distance = max_distance;
@@ -119,7 +129,7 @@ struct SceneTracer {
             if (!(geo->flags & visibility_flag))
                 continue;
 
-            if (hitGeometryInLocalSpace(*geo, scene.meshes, ray, aux_hit, any_hit)) {
+            if (hitGeometryInLocalSpace(*geo, scene.meshes, ray, aux_hit, any_hit, geometry_lods ? geometry_lods[geometry_indices[i]] : 0)) {
                 if (any_hit)
                     return geo;
 
@@ -134,7 +144,7 @@ struct SceneTracer {
         return hit_geo;
     }
 
-    INLINE_XPU bool hitGeometryInLocalSpace(const Geometry &geo, const Mesh *meshes, const Ray &ray, RayHit &hit, bool any_hit = false) {
+    INLINE_XPU bool hitGeometryInLocalSpace(const Geometry &geo, const Mesh *meshes, const Ray &ray, RayHit &hit, bool any_hit = false, u32 lod_index = 0) {
         aux_ray.localize(ray, geo.transform);
         aux_ray.pixel_coords = ray.pixel_coords;
         aux_ray.depth = ray.depth;
@@ -158,7 +168,7 @@ struct SceneTracer {
             case GeometryType_Box: return aux_ray.hitsDefaultBox(hit, geo.flags & GEOMETRY_IS_TRANSPARENT);
             case GeometryType_Sphere: return aux_ray.hitsDefaultSphere(hit, geo.flags & GEOMETRY_IS_TRANSPARENT);
             case GeometryType_Tet   : return aux_ray.hitsDefaultTetrahedron(hit, geo.flags & GEOMETRY_IS_TRANSPARENT);
-            case GeometryType_Mesh  : return mesh_tracer.trace(meshes[geo.id], aux_ray, hit, any_hit);
+            case GeometryType_Mesh  : return mesh_tracer.trace(meshes[geo.id].lod(lod_index), aux_ray, hit, any_hit);
             default: return false;
         }
     }
@@ -15,13 +15,17 @@ bool allocateMemory(BVH &bvh, memory::MonotonicAllocator *memory_allocator) {
     return true;
 }
 
+// The height is a u8 but takes a u32 in files:
 void writeHeader(const BVH &bvh, void *file) {
+    u32 height = bvh.height;
     os::writeToFile((void*)&bvh.node_count,     sizeof(u32),  file);
-    os::writeToFile((void*)&bvh.height,         sizeof(u32),  file);
+    os::writeToFile(&height,                    sizeof(u32),  file);
 }
-void readHeader(const BVH &bvh, void *file) {
-    os::readFromFile((void*)&bvh.node_count,     sizeof(u32),  file);
-    os::readFromFile((void*)&bvh.height,         sizeof(u32),  file);
+void readHeader(BVH &bvh, void *file) {
+    u32 height = 0;
+    os::readFromFile(&bvh.node_count,           sizeof(u32),  file);
+    os::readFromFile(&height,                   sizeof(u32),  file);
+    bvh.height = (u8)height;
 }
 
 bool saveHeader(const BVH &bvh, char *file_path) {
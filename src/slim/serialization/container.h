@@ -0,0 +1,251 @@
+#pragma once
+
+#include "../core/base.h"
+
+// Files are a header, a table of chunks, then the chunks' contents (each at an offset aligned as its chunk
+// asks, padded with zeros). A chunk is identified by its type and index (e.g. an array of one of a mesh's
+// LODs), and has its own version so its layout can evolve without touching the others. Optionally, the
+// table and every chunk have a CRC32C (Castagnoli) checksum, checked on request.
+// Readers validate the header and table once (see openContainer()), then hand out views of the chunks'
+// contents straight from the file's memory (usually a mapping, see mapContainer()):
+#define CONTAINER_MAGIC 0x4D494C53 // "SLIM"
+#define CONTAINER_VERSION 1
+#define CONTAINER_ALIGNMENT 64
+#define CONTAINER_MAX_ALIGNMENT 4096
+#define CONTAINER_MAX_CHUNK_COUNT 128
+
+enum ContainerType {
+    ContainerType_Mesh = 1,
+    ContainerType_Texture
+};
+
+enum ContainerFlag {
+    ContainerFlag_CRC = 1
+};
+
+enum ChunkType {
+    ChunkType_MeshHeader = 1,
+    ChunkType_MeshArray,       // Index: LOD * MeshArray_Count + MeshArray (see serialization/mesh.h)
+    ChunkType_TextureHeader,
+    ChunkType_TextureMipSizes,
+    ChunkType_TextureMip       // Index: Mip
+};
+
+struct ContainerHeader {
+    u32 magic;
+    u32 version;     // Of the header and the chunk table
+    u32 type;        // ContainerType
+    u32 flags;       // ContainerFlag
+    u32 chunk_count;
+    u32 table_crc;
+    u64 file_size;
+};
+
+struct ContainerChunk {
+    u32 type;        // ChunkType
+    u16 index;
+    u16 version;     // Of the content's layout
+    u32 alignment;
+    u32 crc;         // Of the content (0 without ContainerFlag_CRC)
+    u64 offset;      // From the start of the file
+    u64 size;
+};
+
+// Slicing-by-8: The tables advance the CRC through 8 bytes at a time (table i through a byte followed by i others):
+struct CRC32CTables {
+    u32 tables[8][256];
+
+    CRC32CTables() {
+        for (u32 i = 0; i < 256; i++) {
+            u32 crc = i;
+            for (u32 bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+            tables[0][i] = crc;
+        }
+        for (u32 i = 0; i < 256; i++)
+            for (u32 t = 1; t < 8; t++)
+                tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+    }
+};
+
+u32 getCRC32C(const void *bytes, u64 size, u32 crc = 0) {
+    static CRC32CTables crc_tables;
+    const u32 (*tables)[256] = crc_tables.tables;
+    const u8 *byte = (const u8*)bytes;
+    crc ^= 0xFFFFFFFF;
+    for (; size && ((u64)byte & 7); size--) crc = (crc >> 8) ^ tables[0][(crc ^ *byte++) & 0xFF];
+    for (; size >= 8; size -= 8, byte += 8) {
+        const u32 low  = crc ^ (byte[0] | (byte[1] << 8) | (byte[2] << 16) | ((u32)byte[3] << 24));
+        const u32 high = byte[4] | (byte[5] << 8) | (byte[6] << 16) | ((u32)byte[7] << 24);
+        crc = tables[7][ low         & 0xFF] ^ tables[6][(low  >>  8) & 0xFF] ^
+              tables[5][(low  >> 16) & 0xFF] ^ tables[4][(low  >> 24) & 0xFF] ^
+              tables[3][ high        & 0xFF] ^ tables[2][(high >>  8) & 0xFF] ^
+              tables[1][(high >> 16) & 0xFF] ^ tables[0][(high >> 24) & 0xFF];
+    }
+    for (; size; size--) crc = (crc >> 8) ^ tables[0][(crc ^ *byte++) & 0xFF];
+    return crc ^ 0xFFFFFFFF;
+}
+
+INLINE u64 alignFileOffset(u64 offset, u32 alignment) {
+    return (offset + (alignment - 1)) & ~(u64)(alignment - 1);
+}
+
+INLINE u64 getChunkTableSize(u32 chunk_count) {
+    return sizeof(ContainerHeader) + sizeof(ContainerChunk) * chunk_count;
+}
+
+// Chunks have to lie after the table and within the file, at offsets aligned to a power of 2:
+bool validateChunkTable(const ContainerHeader &header, const ContainerChunk *chunks, u32 type) {
+    if (header.magic != CONTAINER_MAGIC || header.version != CONTAINER_VERSION || header.type != type ||
+        header.chunk_count > CONTAINER_MAX_CHUNK_COUNT || header.file_size < getChunkTableSize(header.chunk_count))
+        return false;
+
+    const u64 table_size = getChunkTableSize(header.chunk_count);
+    for (u32 i = 0; i < header.chunk_count; i++) {
+        const ContainerChunk &chunk = chunks[i];
+        if (!chunk.alignment || chunk.alignment > CONTAINER_MAX_ALIGNMENT || (chunk.alignment & (chunk.alignment - 1)) ||
+            (chunk.offset & (chunk.alignment - 1)) || chunk.offset < table_size ||
+            chunk.offset > header.file_size || chunk.size > header.file_size - chunk.offset)
+            return false;
+    }
+    return true;
+}
+
+const ContainerChunk* findChunk(const ContainerHeader &header, const ContainerChunk *chunks, u32 type, u32 index = 0) {
+    for (u32 i = 0; i < header.chunk_count; i++)
+        if (chunks[i].type == type && chunks[i].index == index) return chunks + i;
+    return nullptr;
+}
+
+struct ContainerView {
+    const u8 *memory{nullptr};
+    const ContainerHeader *header{nullptr};
+    const ContainerChunk *chunks{nullptr};
+    u64 size{0};
+
+    const ContainerChunk* findChunk(u32 type, u32 index = 0) const {
+        return ::findChunk(*header, chunks, type, index);
+    }
+
+    // The chunk's content, if it is there and has the given size:
+    const void* getChunk(u32 type, u32 index, u64 size) const {
+        const ContainerChunk *chunk = findChunk(type, index);
+        return chunk && chunk->size == size ? memory + chunk->offset : nullptr;
+    }
+
+    template <typename T>
+    const T* getChunkArray(u32 type, u32 index, u64 count) const {
+        const ContainerChunk *chunk = findChunk(type, index);
+        if (!chunk || chunk->size != sizeof(T) * count || ((u64)(memory + chunk->offset) % alignof(T))) return nullptr;
+        return (const T*)(memory + chunk->offset);
+    }
+};
+
+// Validates the container in memory (checking its CRCs, if it has them and verify_crc is set):
+bool openContainer(ContainerView &view, const void *memory, u64 size, u32 type, bool verify_crc = false) {
+    view = ContainerView{};
+    if (!memory || size < sizeof(ContainerHeader)) return false;
+
+    const ContainerHeader *header = (const ContainerHeader*)memory;
+    const ContainerChunk *chunks = (const ContainerChunk*)(header + 1);
+    if (header->file_size != size || !validateChunkTable(*header, chunks, type)) return false;
+
+    if (verify_crc && (header->flags & ContainerFlag_CRC)) {
+        if (getCRC32C(chunks, sizeof(ContainerChunk) * header->chunk_count) != header->table_crc) return false;
+        for (u32 i = 0; i < header->chunk_count; i++)
+            if (getCRC32C((const u8*)memory + chunks[i].offset, chunks[i].size) != chunks[i].crc) return false;
+    }
+
+    view.memory = (const u8*)memory;
+    view.header = header;
+    view.chunks = chunks;
+    view.size = size;
+    return true;
+}
+
+bool mapContainer(ContainerView &view, const char *file_path, u32 type, bool verify_crc = false) {
+    u64 size;
+    void *memory = os::mapFileForReading(file_path, &size);
+    if (openContainer(view, memory, size, type, verify_crc)) return true;
+
+    if (memory) os::unmapFile(memory);
+    return false;
+}
+
+void unmapContainer(ContainerView &view) {
+    if (view.memory) os::unmapFile((void*)view.memory);
+    view = ContainerView{};
+}
+
+// For reading a container through a file instead (leaving the file position after the table). Returns false
+// for files that are not valid containers of that type (like files in older formats):
+bool readChunkTable(void *file, ContainerHeader &header, ContainerChunk *chunks, u32 type) {
+    if (!os::setFilePosition(file, 0) ||
+        !os::readFromFile(&header, sizeof(ContainerHeader), file) ||
+        header.magic != CONTAINER_MAGIC || header.chunk_count > CONTAINER_MAX_CHUNK_COUNT ||
+        !os::readFromFile(chunks, (u32)(sizeof(ContainerChunk) * header.chunk_count), file))
+        return false;
+
+    return header.file_size == (u64)os::getFileSize(file) && validateChunkTable(header, chunks, type);
+}
+
+bool readChunk(void *file, const ContainerChunk *chunk, void *content, u64 size) {
+    return chunk && chunk->size == size &&
+           os::setFilePosition(file, chunk->offset) &&
+           os::readFromFile(content, (u32)size, file);
+}
+
+// Gathers chunks (pointing at their contents, that have to outlive it) and writes them all out:
+struct ContainerWriter {
+    ContainerChunk chunks[CONTAINER_MAX_CHUNK_COUNT];
+    const void *contents[CONTAINER_MAX_CHUNK_COUNT];
+    u32 chunk_count = 0;
+
+    bool add(u32 type, u32 index, u32 version, const void *content, u64 size, u32 alignment = CONTAINER_ALIGNMENT) {
+        if (chunk_count == CONTAINER_MAX_CHUNK_COUNT) return false;
+
+        ContainerChunk &chunk = chunks[chunk_count];
+        chunk = ContainerChunk{};
+        chunk.type = type;
+        chunk.index = (u16)index;
+        chunk.version = (u16)version;
+        chunk.alignment = alignment;
+        chunk.size = size;
+        contents[chunk_count++] = content;
+        return true;
+    }
+
+    bool save(char *file_path, u32 type, bool with_crc = true) {
+        ContainerHeader header{};
+        header.magic = CONTAINER_MAGIC;
+        header.version = CONTAINER_VERSION;
+        header.type = type;
+        header.flags = with_crc ? ContainerFlag_CRC : 0;
+        header.chunk_count = chunk_count;
+
+        u64 offset = getChunkTableSize(chunk_count);
+        for (u32 i = 0; i < chunk_count; i++) {
+            chunks[i].offset = alignFileOffset(offset, chunks[i].alignment);
+            chunks[i].crc = with_crc ? getCRC32C(contents[i], chunks[i].size) : 0;
+            offset = chunks[i].offset + chunks[i].size;
+        }
+        header.file_size = offset;
+        header.table_crc = with_crc ? getCRC32C(chunks, sizeof(ContainerChunk) * chunk_count) : 0;
+
+        void *file = os::openFileForWriting(file_path);
+        if (!file) return false;
+
+        static u8 padding[CONTAINER_MAX_ALIGNMENT] = {};
+        bool saved = os::writeToFile(&header, sizeof(ContainerHeader), file) &&
+                     os::writeToFile(chunks, (u32)(sizeof(ContainerChunk) * chunk_count), file);
+        offset = getChunkTableSize(chunk_count);
+        for (u32 i = 0; i < chunk_count && saved; i++) {
+            if (chunks[i].offset != offset) saved = os::writeToFile(padding, (u32)(chunks[i].offset - offset), file);
+            const u8 *content = (const u8*)contents[i];
+            for (u64 written = 0; written < chunks[i].size && saved; written += Gigabytes(1))
+                saved = os::writeToFile((void*)(content + written), (u32)Min(chunks[i].size - written, (u64)Gigabytes(1)), file);
+            offset = chunks[i].offset + chunks[i].size;
+        }
+        os::closeFile(file);
+        return saved;
+    }
+};
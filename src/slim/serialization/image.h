@@ -1,9 +1,11 @@
 #pragma once
 
 #include "../core/string.h"
+#include "../core/block_compression.h"
 
 template <typename T>
 u32 getSizeInBytes(const Image<T> &image) {
+    if (image.flags.compression) return getCompressedSize(image);
     return sizeof(T) * image.size * (image.flags.channel ? (image.flags.alpha ? 4 : 3) : 1);
 }
 
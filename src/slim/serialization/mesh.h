@@ -3,6 +3,7 @@
 #include "../core/string.h"
 #include "../scene/mesh.h"
 #include "./bvh.h"
+#include "./container.h"
 
 
 u32 getSizeInBytes(const Mesh &mesh, u32 *bvh_nodes_size = nullptr) {
@@ -100,6 +101,7 @@ void readContent(Mesh &mesh, void *file) {
     os::readFromFile(&mesh.aabb.max,       sizeof(vec3), file);
     os::readFromFile(mesh.triangles,       sizeof(Triangle) * mesh.triangle_count, file);
     os::readFromFile(mesh.vertex_positions,             sizeof(vec3)                  * mesh.vertex_count,   file);
+    mesh.positionsChanged();
     os::readFromFile(mesh.vertex_position_indices,      sizeof(TriangleVertexIndices) * mesh.triangle_count, file);
     os::readFromFile(mesh.edge_vertex_indices,          sizeof(EdgeVertexIndices)     * mesh.edge_count,     file);
     if (mesh.uvs_count) {
@@ -154,18 +156,326 @@ bool loadContent(Mesh &mesh, char *file_path) {
     return true;
 }
 
+// In v1 files, LODs follow the mesh's content: Their count, their headers, then their contents. They share the
+// mesh's vertices, so only have their own triangles, indices and BVH (files without any end after the mesh):
+u64 getLODsPosition(const Mesh &mesh) {
+    return sizeof(u32) * 8 + sizeof(vec3) * 2 + getSizeInBytes(mesh);
+}
+
+u32 getLODSizeInBytes(const Mesh &lod, u32 *bvh_nodes_size = nullptr) {
+    u32 memory_size = getSizeInBytes(lod.bvh);
+    if (bvh_nodes_size) {
+        *bvh_nodes_size += memory_size;
+        memory_size = 0;
+    }
+
+    u32 index_array_count = 1;
+    if (lod.uvs_count)      index_array_count++;
+    if (lod.normals_count)  index_array_count++;
+    if (lod.tangents_count) index_array_count++;
+    memory_size += sizeof(Triangle) * lod.triangle_count;
+    memory_size += sizeof(TriangleVertexIndices) * lod.triangle_count * index_array_count;
+    return memory_size;
+}
+
+bool allocateLODMemory(Mesh &lod, memory::MonotonicAllocator *memory_allocator, memory::MonotonicAllocator *memory_allocator_for_bvh_nodes = nullptr) {
+    u32 bvh_nodes_size = 0;
+    if (getLODSizeInBytes(lod, memory_allocator_for_bvh_nodes ? &bvh_nodes_size : nullptr) > (memory_allocator->capacity - memory_allocator->occupied)) return false;
+    allocateMemory(lod.bvh, memory_allocator_for_bvh_nodes ? memory_allocator_for_bvh_nodes : memory_allocator);
+
+    lod.triangles               = (Triangle*             )memory_allocator->allocate(sizeof(Triangle)              * lod.triangle_count);
+    lod.vertex_position_indices = (TriangleVertexIndices*)memory_allocator->allocate(sizeof(TriangleVertexIndices) * lod.triangle_count);
+    if (lod.uvs_count)      lod.vertex_uvs_indices     = (TriangleVertexIndices*)memory_allocator->allocate(sizeof(TriangleVertexIndices) * lod.triangle_count);
+    if (lod.normals_count)  lod.vertex_normal_indices  = (TriangleVertexIndices*)memory_allocator->allocate(sizeof(TriangleVertexIndices) * lod.triangle_count);
+    if (lod.tangents_count) lod.vertex_tangent_indices = (TriangleVertexIndices*)memory_allocator->allocate(sizeof(TriangleVertexIndices) * lod.triangle_count);
+    return true;
+}
+
+// Reads the count and headers of the LODs (into a temporary LOD, for their memory only) from where they start:
+u32 getLODsSizeInBytes(const Mesh &mesh, void *file, u32 *bvh_nodes_size = nullptr) {
+    u32 lod_count = 0;
+    os::readFromFile(&lod_count, sizeof(u32), file);
+    if (lod_count > MESH_MAX_LOD_COUNT) return 0;
+
+    u32 memory_size = sizeof(Mesh) * lod_count;
+    for (u32 i = 0; i < lod_count; i++) {
+        Mesh lod = mesh.makeLOD(0);
+        os::readFromFile(&lod.triangle_count, sizeof(u32), file);
+        readHeader(lod.bvh, file);
+        memory_size += getLODSizeInBytes(lod, bvh_nodes_size);
+    }
+    return memory_size;
+}
+
+bool readLODs(Mesh &mesh, void *file, memory::MonotonicAllocator *memory_allocator, memory::MonotonicAllocator *memory_allocator_for_bvh_nodes = nullptr) {
+    mesh.lod_count = 0;
+    mesh.lods = nullptr;
+    u32 lod_count = 0;
+    os::readFromFile(&lod_count, sizeof(u32), file);
+    if (!lod_count) return true;
+    if (lod_count > MESH_MAX_LOD_COUNT ||
+        sizeof(Mesh) * lod_count > (memory_allocator->capacity - memory_allocator->occupied)) return false;
+
+    Mesh *lods = (Mesh*)memory_allocator->allocate(sizeof(Mesh) * lod_count);
+    for (u32 i = 0; i < lod_count; i++) {
+        lods[i] = mesh.makeLOD(0);
+        os::readFromFile(&lods[i].triangle_count, sizeof(u32), file);
+        readHeader(lods[i].bvh, file);
+    }
+    for (u32 i = 0; i < lod_count; i++) {
+        Mesh &lod = lods[i];
+        if (!allocateLODMemory(lod, memory_allocator, memory_allocator_for_bvh_nodes)) return false;
+
+        os::readFromFile(lod.triangles,               sizeof(Triangle)              * lod.triangle_count, file);
+        os::readFromFile(lod.vertex_position_indices, sizeof(TriangleVertexIndices) * lod.triangle_count, file);
+        if (lod.uvs_count)      os::readFromFile(lod.vertex_uvs_indices,     sizeof(TriangleVertexIndices) * lod.triangle_count, file);
+        if (lod.normals_count)  os::readFromFile(lod.vertex_normal_indices,  sizeof(TriangleVertexIndices) * lod.triangle_count, file);
+        if (lod.tangents_count) os::readFromFile(lod.vertex_tangent_indices, sizeof(TriangleVertexIndices) * lod.triangle_count, file);
+        readContent(lod.bvh, file);
+    }
+    mesh.lods = lods;
+    mesh.lod_count = lod_count;
+    return true;
+}
+
+// v2 files are containers (see serialization/container.h) with a header chunk holding the counts, then a chunk
+// for every array of the mesh and of each of its LODs. Arrays are stored just as they are in memory, so a mapped
+// file is used in place (see map()). v1 files have a header then all the arrays back to back, and are read:
+#define MESH_FILE_VERSION 2
+
+enum MeshArray {
+    MeshArray_Triangles,
+    MeshArray_VertexPositions,
+    MeshArray_VertexNormals,
+    MeshArray_VertexTangents,
+    MeshArray_VertexUVs,
+    MeshArray_VertexPositionIndices,
+    MeshArray_VertexNormalIndices,
+    MeshArray_VertexTangentIndices,
+    MeshArray_VertexUVsIndices,
+    MeshArray_EdgeVertexIndices,
+    MeshArray_BVHNodes,
+
+    MeshArray_Count
+};
+
+struct MeshFileLOD {
+    u32 triangle_count, bvh_node_count, bvh_height, padding;
+};
+
+struct MeshFileHeader {
+    u32 vertex_count, triangle_count, edge_count, uvs_count, normals_count, tangents_count;
+    u32 bvh_node_count, bvh_height, lod_count, padding;
+    AABB aabb;
+    MeshFileLOD lods[MESH_MAX_LOD_COUNT];
+};
+
+// LODs only have their own triangles, indices and BVH nodes (their vertex arrays being the mesh's):
+void getArrays(const Mesh &mesh, bool is_lod, void **arrays, u64 *sizes) {
+    arrays[MeshArray_Triangles]             = mesh.triangles;
+    arrays[MeshArray_VertexPositions]       = is_lod ? nullptr : mesh.vertex_positions;
+    arrays[MeshArray_VertexNormals]         = is_lod ? nullptr : mesh.vertex_normals;
+    arrays[MeshArray_VertexTangents]        = is_lod ? nullptr : mesh.vertex_tangents;
+    arrays[MeshArray_VertexUVs]             = is_lod ? nullptr : mesh.vertex_uvs;
+    arrays[MeshArray_VertexPositionIndices] = mesh.vertex_position_indices;
+    arrays[MeshArray_VertexNormalIndices]   = mesh.vertex_normal_indices;
+    arrays[MeshArray_VertexTangentIndices]  = mesh.vertex_tangent_indices;
+    arrays[MeshArray_VertexUVsIndices]      = mesh.vertex_uvs_indices;
+    arrays[MeshArray_EdgeVertexIndices]     = is_lod ? nullptr : mesh.edge_vertex_indices;
+    arrays[MeshArray_BVHNodes]              = mesh.bvh.nodes;
+
+    sizes[MeshArray_Triangles]             = sizeof(Triangle)              * (u64)mesh.triangle_count;
+    sizes[MeshArray_VertexPositions]       = is_lod ? 0 : sizeof(vec3)     * (u64)mesh.vertex_count;
+    sizes[MeshArray_VertexNormals]         = is_lod ? 0 : sizeof(vec3)     * (u64)mesh.normals_count;
+    sizes[MeshArray_VertexTangents]        = is_lod ? 0 : sizeof(vec3)     * (u64)mesh.tangents_count;
+    sizes[MeshArray_VertexUVs]             = is_lod ? 0 : sizeof(vec2)     * (u64)mesh.uvs_count;
+    sizes[MeshArray_VertexPositionIndices] = sizeof(TriangleVertexIndices) * (u64)mesh.triangle_count;
+    sizes[MeshArray_VertexNormalIndices]   = mesh.normals_count  ? sizes[MeshArray_VertexPositionIndices] : 0;
+    sizes[MeshArray_VertexTangentIndices]  = mesh.tangents_count ? sizes[MeshArray_VertexPositionIndices] : 0;
+    sizes[MeshArray_VertexUVsIndices]      = mesh.uvs_count      ? sizes[MeshArray_VertexPositionIndices] : 0;
+    sizes[MeshArray_EdgeVertexIndices]     = is_lod ? 0 : sizeof(EdgeVertexIndices) * (u64)mesh.edge_count;
+    sizes[MeshArray_BVHNodes]              = sizeof(BVHNode)               * (u64)mesh.bvh.node_count;
+}
+
+void setArrays(Mesh &mesh, bool is_lod, void **arrays) {
+    mesh.triangles               = (Triangle*             )arrays[MeshArray_Triangles];
+    mesh.vertex_position_indices = (TriangleVertexIndices*)arrays[MeshArray_VertexPositionIndices];
+    mesh.vertex_normal_indices   = (TriangleVertexIndices*)arrays[MeshArray_VertexNormalIndices];
+    mesh.vertex_tangent_indices  = (TriangleVertexIndices*)arrays[MeshArray_VertexTangentIndices];
+    mesh.vertex_uvs_indices      = (TriangleVertexIndices*)arrays[MeshArray_VertexUVsIndices];
+    mesh.bvh.nodes               = (BVHNode*              )arrays[MeshArray_BVHNodes];
+    if (is_lod) return;
+
+    mesh.vertex_positions    = (vec3*             )arrays[MeshArray_VertexPositions];
+    mesh.vertex_normals      = (vec3*             )arrays[MeshArray_VertexNormals];
+    mesh.vertex_tangents     = (vec3*             )arrays[MeshArray_VertexTangents];
+    mesh.vertex_uvs          = (vec2*             )arrays[MeshArray_VertexUVs];
+    mesh.edge_vertex_indices = (EdgeVertexIndices*)arrays[MeshArray_EdgeVertexIndices];
+    mesh.positionsChanged();
+}
+
+void setCounts(Mesh &mesh, const MeshFileHeader &header) {
+    mesh.aabb           = header.aabb;
+    mesh.vertex_count   = header.vertex_count;
+    mesh.triangle_count = header.triangle_count;
+    mesh.edge_count     = header.edge_count;
+    mesh.uvs_count      = header.uvs_count;
+    mesh.normals_count  = header.normals_count;
+    mesh.tangents_count = header.tangents_count;
+    mesh.bvh.node_count = header.bvh_node_count;
+    mesh.bvh.height     = (u8)header.bvh_height;
+}
+
+void setCounts(Mesh &lod, const MeshFileLOD &file_lod) {
+    lod.triangle_count = file_lod.triangle_count;
+    lod.bvh.node_count = file_lod.bvh_node_count;
+    lod.bvh.height     = (u8)file_lod.bvh_height;
+}
+
 bool save(const Mesh &mesh, char* file_path) {
-    void *file = os::openFileForWriting(file_path);
-    if (!file) return false;
-    writeHeader(mesh, file);
-    writeContent(mesh, file);
-    os::closeFile(file);
+    if (mesh.lod_count > MESH_MAX_LOD_COUNT) return false;
+
+    MeshFileHeader header{};
+    header.vertex_count   = mesh.vertex_count;
+    header.triangle_count = mesh.triangle_count;
+    header.edge_count     = mesh.edge_count;
+    header.uvs_count      = mesh.uvs_count;
+    header.normals_count  = mesh.normals_count;
+    header.tangents_count = mesh.tangents_count;
+    header.bvh_node_count = mesh.bvh.node_count;
+    header.bvh_height     = mesh.bvh.height;
+    header.lod_count      = mesh.lod_count;
+    header.aabb           = mesh.aabb;
+    for (u32 i = 0; i < mesh.lod_count; i++) {
+        header.lods[i].triangle_count = mesh.lods[i].triangle_count;
+        header.lods[i].bvh_node_count = mesh.lods[i].bvh.node_count;
+        header.lods[i].bvh_height     = mesh.lods[i].bvh.height;
+    }
+
+    ContainerWriter writer;
+    writer.add(ChunkType_MeshHeader, 0, MESH_FILE_VERSION, &header, sizeof(MeshFileHeader));
+    void *arrays[MeshArray_Count];
+    u64 sizes[MeshArray_Count];
+    for (u32 l = 0; l <= mesh.lod_count; l++) {
+        getArrays(mesh.lod(l), l != 0, arrays, sizes);
+        for (u32 i = 0; i < MeshArray_Count; i++)
+            if (sizes[i] && !writer.add(ChunkType_MeshArray, l * MeshArray_Count + i, MESH_FILE_VERSION, arrays[i], sizes[i]))
+                return false;
+    }
+    return writer.save(file_path, ContainerType_Mesh);
+}
+
+// Views of the arrays of the mesh (LOD 0) or of one of its LODs, which have to be there with the right sizes:
+bool getMappedArrays(const ContainerView &file, u32 lod_index, const u64 *sizes, void **arrays) {
+    for (u32 i = 0; i < MeshArray_Count; i++) {
+        arrays[i] = nullptr;
+        if (!sizes[i]) continue;
+
+        arrays[i] = (void*)file.getChunk(ChunkType_MeshArray, lod_index * MeshArray_Count + i, sizes[i]);
+        if (!arrays[i] || ((u64)arrays[i] % sizeof(f32))) return false;
+    }
+    return true;
+}
+
+// Points the mesh's arrays (but not its LODs') straight into the mapped file:
+bool mapContent(Mesh &mesh, const ContainerView &file) {
+    const MeshFileHeader *header = (const MeshFileHeader*)file.getChunk(ChunkType_MeshHeader, 0, sizeof(MeshFileHeader));
+    if (!header || header->lod_count > MESH_MAX_LOD_COUNT) return false;
+
+    void *arrays[MeshArray_Count];
+    u64 sizes[MeshArray_Count];
+    mesh = Mesh{};
+    setCounts(mesh, *header);
+    getArrays(mesh, false, arrays, sizes);
+    if (!getMappedArrays(file, 0, sizes, arrays)) return false;
+    setArrays(mesh, false, arrays);
     return true;
 }
 
+// Maps the file if it is a valid v2 file, having all the arrays of the mesh and of its LODs:
+bool mapMeshFile(ContainerView &file, const char *file_path) {
+    if (!mapContainer(file, file_path, ContainerType_Mesh)) return false;
+
+    Mesh mesh;
+    bool valid = mapContent(mesh, file);
+    const MeshFileHeader *header = (const MeshFileHeader*)file.getChunk(ChunkType_MeshHeader, 0, sizeof(MeshFileHeader));
+    void *arrays[MeshArray_Count];
+    u64 sizes[MeshArray_Count];
+    for (u32 i = 0; valid && i < header->lod_count; i++) {
+        Mesh lod = mesh.makeLOD(0);
+        setCounts(lod, header->lods[i]);
+        getArrays(lod, true, arrays, sizes);
+        valid = getMappedArrays(file, i + 1, sizes, arrays);
+    }
+    if (valid) return true;
+
+    unmapContainer(file);
+    return false;
+}
+
+// Points the arrays of the mesh and of its LODs straight into the mapped file (so they are read-only), only
+// taking the LODs themselves from the memory allocator (see getMappedSizeInBytes()). The file stays mapped:
+u32 getMappedSizeInBytes(const ContainerView &file) {
+    const MeshFileHeader *header = (const MeshFileHeader*)file.getChunk(ChunkType_MeshHeader, 0, sizeof(MeshFileHeader));
+    return header ? sizeof(Mesh) * header->lod_count : 0;
+}
+
+bool map(Mesh &mesh, const ContainerView &file, memory::MonotonicAllocator *memory_allocator) {
+    if (getMappedSizeInBytes(file) > (memory_allocator->capacity - memory_allocator->occupied) ||
+        !mapContent(mesh, file))
+        return false;
+
+    const MeshFileHeader *header = (const MeshFileHeader*)file.getChunk(ChunkType_MeshHeader, 0, sizeof(MeshFileHeader));
+    if (header->lod_count) {
+        mesh.lods = (Mesh*)memory_allocator->allocate(getMappedSizeInBytes(file));
+        mesh.lod_count = header->lod_count;
+    }
+    void *arrays[MeshArray_Count];
+    u64 sizes[MeshArray_Count];
+    for (u32 i = 0; i < header->lod_count; i++) {
+        Mesh &lod = mesh.lods[i];
+        lod = mesh.makeLOD(0);
+        setCounts(lod, header->lods[i]);
+        getArrays(lod, true, arrays, sizes);
+        if (!getMappedArrays(file, i + 1, sizes, arrays)) return false;
+        setArrays(lod, true, arrays);
+    }
+    return true;
+}
+
+bool map(Mesh &mesh, char *file_path, memory::MonotonicAllocator *memory_allocator) {
+    ContainerView file;
+    return mapMeshFile(file, file_path) && map(mesh, file, memory_allocator);
+}
+
+// Copies a mapped mesh's arrays into the mesh's own (same sized) arrays:
+void copyContent(Mesh &mesh, const Mesh &mapped_mesh) {
+    void *arrays[MeshArray_Count], *mapped_arrays[MeshArray_Count];
+    u64 sizes[MeshArray_Count];
+    getArrays(mesh, false, arrays, sizes);
+    getArrays(mapped_mesh, false, mapped_arrays, sizes);
+    for (u32 i = 0; i < MeshArray_Count; i++)
+        if (arrays[i] && mapped_arrays[i])
+            for (u64 b = 0; b < sizes[i]; b++) ((u8*)arrays[i])[b] = ((u8*)mapped_arrays[i])[b];
+    mesh.aabb = mapped_mesh.aabb;
+    mesh.positionsChanged();
+}
+
+// v2 files are mapped when given a memory allocator (see map()), and copied into the mesh's arrays otherwise:
 bool load(Mesh &mesh, char *file_path,
           memory::MonotonicAllocator *memory_allocator = nullptr,
           memory::MonotonicAllocator *memory_allocator_for_bvh_nodes = nullptr) {
+    ContainerView mapped_file;
+    if (mapMeshFile(mapped_file, file_path)) {
+        if (memory_allocator) return map(mesh, mapped_file, memory_allocator);
+
+        Mesh mapped_mesh;
+        bool loaded = mesh.vertex_positions && mapContent(mapped_mesh, mapped_file);
+        if (loaded) copyContent(mesh, mapped_mesh);
+        unmapContainer(mapped_file);
+        return loaded;
+    }
+
     void *file = os::openFileForReading(file_path);
     if (!file) return false;
 
@@ -175,19 +485,40 @@ bool load(Mesh &mesh, char *file_path,
         if (!allocateMemory(mesh, memory_allocator, memory_allocator_for_bvh_nodes)) return false;
     } else if (!mesh.vertex_positions) return false;
     readContent(mesh, file);
+    bool loaded = !memory_allocator || readLODs(mesh, file, memory_allocator, memory_allocator_for_bvh_nodes);
     os::closeFile(file);
-    return true;
+    return loaded;
 }
 
-u32 getTotalMemoryForMeshes(String *mesh_files, u32 mesh_count, u32 *max_triangle_count = nullptr, u32 *bvh_nodes_size = nullptr) {
+// v2 files are mapped, and only need memory for their LODs. Passing mapped_mesh_files keeps them mapped for
+// map() (left empty for v1 files), so they are only opened once:
+u32 getTotalMemoryForMeshes(String *mesh_files, u32 mesh_count, u32 *max_triangle_count = nullptr, u32 *bvh_nodes_size = nullptr,
+                            ContainerView *mapped_mesh_files = nullptr) {
     u32 memory_size = 0;
     if (max_triangle_count) *max_triangle_count = 0;
     for (u32 i = 0; i < mesh_count; i++) {
+        ContainerView mapped_file;
+        if (mapMeshFile(mapped_file, mesh_files[i].char_ptr)) {
+            const MeshFileHeader *header = (const MeshFileHeader*)mapped_file.getChunk(ChunkType_MeshHeader, 0, sizeof(MeshFileHeader));
+            if (max_triangle_count) *max_triangle_count = Max(*max_triangle_count, header->triangle_count);
+            memory_size += getMappedSizeInBytes(mapped_file);
+            if (mapped_mesh_files) mapped_mesh_files[i] = mapped_file;
+            else unmapContainer(mapped_file);
+            continue;
+        }
+        if (mapped_mesh_files) mapped_mesh_files[i] = ContainerView{};
+
+        void *file = os::openFileForReading(mesh_files[i].char_ptr);
+        if (!file) continue;
+
         Mesh mesh;
-        loadHeader(mesh, mesh_files[i].char_ptr);
+        readHeader(mesh, file);
         if (max_triangle_count) *max_triangle_count = Max(*max_triangle_count, mesh.triangle_count);
         memory_size += getSizeInBytes(mesh, bvh_nodes_size);
+        if (os::setFilePosition(file, getLODsPosition(mesh)))
+            memory_size += getLODsSizeInBytes(mesh, file, bvh_nodes_size);
+        os::closeFile(file);
     }
 
     return memory_size;
-}
\ No newline at end of file
+}
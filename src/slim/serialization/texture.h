@@ -2,6 +2,27 @@
 
 #include "../core/string.h"
 #include "../core/texture.h"
+#include "./container.h"
+
+// .texture files are containers (see serialization/container.h) with a header chunk, a chunk of the mips'
+// dimensions then a chunk of each mip's content. Legacy files (an ImageInfo, then each mip's dimensions and
+// content back to back) are still read:
+#define TEXTURE_FILE_VERSION 1
+#define TEXTURE_FILE_MAX_MIPS 16
+
+struct TextureFileHeader {
+    u32 width, height, size, stride, tile_width, tile_height, mip_count, flags;
+};
+
+struct TextureFileMip {
+    u32 width, height;
+};
+
+// Where the mips' contents are in the file, and their dimensions:
+struct TextureFileLayout {
+    TextureFileMip mips[TEXTURE_FILE_MAX_MIPS];
+    u64 content_positions[TEXTURE_FILE_MAX_MIPS];
+};
 
 
 u32 getSizeInBytes(const Texture &texture) {
@@ -10,13 +31,13 @@ u32 getSizeInBytes(const Texture &texture) {
     u32 memory_size = 0;
 
     if (texture.flags.cubemap) {
-        mip_height = texture.height + 1;
-        mip_width = texture.height * 4 + 1;
-        memory_size = sizeof(TextureMip) * 3 + sizeof(TexelQuad) * (mip_height * (mip_width + 2 * mip_height));
+        memory_size = sizeof(TextureMip) * 3 +
+            TextureMip::GetSizeInBytes(mip_height * 4, mip_height, texture.flags.tile) +
+            TextureMip::GetSizeInBytes(mip_height, mip_height, texture.flags.tile) * 2;
     } else {
         do {
             memory_size += sizeof(TextureMip);
-            memory_size += (mip_width + 1) * (mip_height + 1) * sizeof(TexelQuad);
+            memory_size += TextureMip::GetSizeInBytes(mip_width, mip_height, texture.flags.tile);
 
             mip_width /= 2;
             mip_height /= 2;
@@ -27,6 +48,11 @@ u32 getSizeInBytes(const Texture &texture) {
 }
 
 bool allocateMemory(Texture &texture, memory::MonotonicAllocator *memory_allocator) {
+#ifdef SLIM_TEXEL_QUADS
+    if (texture.flags.apron) return false;
+#else
+    if (!texture.flags.apron) return false;
+#endif
     u32 size = getSizeInBytes(texture);
     if (size > (memory_allocator->capacity - memory_allocator->occupied)) return false;
     texture.mips = (TextureMip*)memory_allocator->allocate(sizeof(TextureMip) * texture.mip_count);
@@ -35,14 +61,12 @@ bool allocateMemory(Texture &texture, memory::MonotonicAllocator *memory_allocat
     u32 mip_height = texture.height;
 
     if (texture.flags.cubemap) {
-        mip_height = texture.height + 1;
-        mip_width = texture.height * 4 + 1;
-        (texture_mip++)->texel_quads = (TexelQuad*)memory_allocator->allocate(sizeof(TexelQuad) * mip_width * mip_height);
-        (texture_mip++)->texel_quads = (TexelQuad*)memory_allocator->allocate(sizeof(TexelQuad) * mip_height * mip_height);
-        (texture_mip++)->texel_quads = (TexelQuad*)memory_allocator->allocate(sizeof(TexelQuad) * mip_height * mip_height);
+        (texture_mip++)->setContent(memory_allocator->allocate(TextureMip::GetSizeInBytes(mip_height * 4, mip_height, texture.flags.tile)));
+        (texture_mip++)->setContent(memory_allocator->allocate(TextureMip::GetSizeInBytes(mip_height, mip_height, texture.flags.tile)));
+        (texture_mip++)->setContent(memory_allocator->allocate(TextureMip::GetSizeInBytes(mip_height, mip_height, texture.flags.tile)));
     } else {
         do {
-            texture_mip->texel_quads = (TexelQuad*)memory_allocator->allocate(sizeof(TexelQuad) * (mip_height + 1) * (mip_width + 1));
+            texture_mip->setContent(memory_allocator->allocate(TextureMip::GetSizeInBytes(mip_width, mip_height, texture.flags.tile)));
             mip_width /= 2;
             mip_height /= 2;
             texture_mip++;
@@ -57,7 +81,12 @@ void readContent(Texture &texture, void *file) {
     for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
         os::readFromFile(&texture_mip->width,  sizeof(u32), file);
         os::readFromFile(&texture_mip->height, sizeof(u32), file);
-        os::readFromFile(texture_mip->texel_quads, sizeof(TexelQuad) * (texture_mip->width + 1) * (texture_mip->height + 1), file);
+        os::readFromFile(texture_mip->content(), TextureMip::GetSizeInBytes(texture_mip->width, texture_mip->height, texture.flags.tile), file);
+#ifndef SLIM_TEXEL_QUADS
+        texture_mip->tiled = texture.flags.tile;
+        texture_mip->page_states = nullptr;
+        texture_mip->used_pages = nullptr;
+#endif
     }
 }
 void writeContent(const Texture &texture, void *file) {
@@ -65,8 +94,126 @@ void writeContent(const Texture &texture, void *file) {
     for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
         os::writeToFile(&texture_mip->width,  sizeof(u32), file);
         os::writeToFile(&texture_mip->height, sizeof(u32), file);
-        os::writeToFile(texture_mip->texel_quads, sizeof(TexelQuad) * (texture_mip->width + 1) * (texture_mip->height + 1), file);
+        os::writeToFile(texture_mip->content(), TextureMip::GetSizeInBytes(texture_mip->width, texture_mip->height, texture.flags.tile), file);
+    }
+}
+
+// Reads the texture's header and the layout of its mips, from either kind of file:
+bool readLayout(Texture &texture, void *file, TextureFileLayout &layout) {
+    ContainerHeader header;
+    ContainerChunk chunks[CONTAINER_MAX_CHUNK_COUNT];
+    if (readChunkTable(file, header, chunks, ContainerType_Texture)) {
+        TextureFileHeader file_header;
+        if (!readChunk(file, findChunk(header, chunks, ChunkType_TextureHeader), &file_header, sizeof(TextureFileHeader)))
+            return false;
+
+        texture.width       = file_header.width;
+        texture.height      = file_header.height;
+        texture.size        = file_header.size;
+        texture.stride      = file_header.stride;
+        texture.tile_width  = file_header.tile_width;
+        texture.tile_height = file_header.tile_height;
+        texture.mip_count   = file_header.mip_count;
+        texture.flags.flags = file_header.flags;
+        if (texture.mip_count > TEXTURE_FILE_MAX_MIPS ||
+            !readChunk(file, findChunk(header, chunks, ChunkType_TextureMipSizes), layout.mips, sizeof(TextureFileMip) * texture.mip_count))
+            return false;
+
+        for (u32 i = 0; i < texture.mip_count; i++) {
+            const ContainerChunk *chunk = findChunk(header, chunks, ChunkType_TextureMip, i);
+            if (!chunk || chunk->size != TextureMip::GetSizeInBytes(layout.mips[i].width, layout.mips[i].height, texture.flags.tile))
+                return false;
+            layout.content_positions[i] = chunk->offset;
+        }
+        return true;
+    }
+
+    if (!os::setFilePosition(file, 0)) return false;
+    readHeader(texture, file);
+    if (texture.mip_count > TEXTURE_FILE_MAX_MIPS) return false;
+
+    u64 position = sizeof(u32) * 8; // The ImageInfo (see readHeader())
+    for (u32 i = 0; i < texture.mip_count; i++) {
+        if (!os::readFromFile(&layout.mips[i], sizeof(TextureFileMip), file)) return false;
+        layout.content_positions[i] = position + sizeof(TextureFileMip);
+        position = layout.content_positions[i] + TextureMip::GetSizeInBytes(layout.mips[i].width, layout.mips[i].height, texture.flags.tile);
+        if (!os::setFilePosition(file, position)) return false;
+    }
+    return true;
+}
+
+bool readContent(Texture &texture, void *file, const TextureFileLayout &layout) {
+    TextureMip *texture_mip = texture.mips;
+    for (u8 mip_index = 0; mip_index < texture.mip_count; mip_index++, texture_mip++) {
+        texture_mip->width  = layout.mips[mip_index].width;
+        texture_mip->height = layout.mips[mip_index].height;
+        if (!os::setFilePosition(file, layout.content_positions[mip_index]) ||
+            !os::readFromFile(texture_mip->content(), TextureMip::GetSizeInBytes(texture_mip->width, texture_mip->height, texture.flags.tile), file))
+            return false;
+#ifndef SLIM_TEXEL_QUADS
+        texture_mip->tiled = texture.flags.tile;
+        texture_mip->page_states = nullptr;
+        texture_mip->used_pages = nullptr;
+#endif
+    }
+    return true;
+}
+
+bool save(const Texture &texture, char* file_path) {
+    if (texture.mip_count > TEXTURE_FILE_MAX_MIPS) return false;
+
+    TextureFileHeader header;
+    header.width       = texture.width;
+    header.height      = texture.height;
+    header.size        = texture.size;
+    header.stride      = texture.stride;
+    header.tile_width  = texture.tile_width;
+    header.tile_height = texture.tile_height;
+    header.mip_count   = texture.mip_count;
+    header.flags       = texture.flags.flags;
+
+    TextureFileMip mips[TEXTURE_FILE_MAX_MIPS];
+    ContainerWriter writer;
+    writer.add(ChunkType_TextureHeader, 0, TEXTURE_FILE_VERSION, &header, sizeof(TextureFileHeader));
+    writer.add(ChunkType_TextureMipSizes, 0, TEXTURE_FILE_VERSION, mips, sizeof(TextureFileMip) * texture.mip_count);
+    for (u32 i = 0; i < texture.mip_count; i++) {
+        const TextureMip &mip = texture.mips[i];
+        mips[i].width  = mip.width;
+        mips[i].height = mip.height;
+        writer.add(ChunkType_TextureMip, i, TEXTURE_FILE_VERSION, mip.content(), TextureMip::GetSizeInBytes(mip.width, mip.height, texture.flags.tile));
+    }
+    return writer.save(file_path, ContainerType_Texture);
+}
+
+bool loadHeader(Texture &texture, char *file_path) {
+    void *file = os::openFileForReading(file_path);
+    if (!file) return false;
+
+    TextureFileLayout layout;
+    bool loaded = readLayout(texture, file, layout);
+    os::closeFile(file);
+    return loaded;
+}
+
+// Without a memory allocator, the content is read into the texture's mips (that have to match the file's):
+bool load(Texture &texture, char *file_path, memory::MonotonicAllocator *memory_allocator = nullptr) {
+    void *file = os::openFileForReading(file_path);
+    if (!file) return false;
+
+    TextureFileLayout layout;
+    bool loaded;
+    if (memory_allocator) {
+        new(&texture) Texture{};
+        loaded = readLayout(texture, file, layout) && allocateMemory(texture, memory_allocator);
+    } else {
+        Texture header;
+        loaded = texture.mips && readLayout(header, file, layout) && header.mip_count == texture.mip_count;
+        for (u32 i = 0; loaded && i < texture.mip_count; i++)
+            loaded = layout.mips[i].width == texture.mips[i].width && layout.mips[i].height == texture.mips[i].height;
     }
+    loaded = loaded && readContent(texture, file, layout);
+    os::closeFile(file);
+    return loaded;
 }
 
 u32 getTotalMemoryForTextures(String *texture_files, u32 texture_count) {
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "./texture.h"
+
+// Streams the mips of textures that are too large to keep resident, a page (TEXTURE_PAGE_SIZE bytes of a
+// mip's content) at a time and within a fixed budget of resident memory. Samplers flag the pages they need
+// (see TextureMip::isResident) and fall back to the nearest coarser resident mip until they arrive.
+// Only mipmapped textures in the apron layout are streamed (cube maps are not), and their last mip is always
+// resident. Other textures are loaded whole.
+#define TEXTURE_STREAMING_MAX_TEXTURES 64
+#define TEXTURE_STREAMING_MAX_MIPS 16
+#define TEXTURE_STREAMING_QUEUE_SIZE 256
+
+INLINE u32 getPageCount(u32 content_size) {
+    return (u32)((content_size + TEXTURE_PAGE_SIZE - 1) / TEXTURE_PAGE_SIZE);
+}
+
+bool isStreamable(const Texture &texture) {
+#ifdef SLIM_TEXEL_QUADS
+    return false;
+#else
+    return texture.flags.apron && texture.flags.mipmap && !texture.flags.cubemap &&
+           texture.mip_count > 1 && texture.mip_count <= TEXTURE_STREAMING_MAX_MIPS;
+#endif
+}
+
+// Memory a texture takes from the memory allocator when streamed: Its mips, the state, usage flag and stamp
+// of every page of all but the last mip, and the content of the last mip (the rest is reserved separately):
+u32 getStreamedSizeInBytes(const Texture &texture) {
+    if (!isStreamable(texture)) return getSizeInBytes(texture);
+
+    u32 mip_width  = texture.width;
+    u32 mip_height = texture.height;
+    u32 memory_size = sizeof(TextureMip) * texture.mip_count;
+    for (u32 i = 0; i < texture.mip_count; i++, mip_width /= 2, mip_height /= 2) {
+        u32 content_size = TextureMip::GetSizeInBytes(mip_width, mip_height, texture.flags.tile);
+        if (i == texture.mip_count - 1)
+            memory_size += content_size;
+        else
+            memory_size += getPageCount(content_size) * (sizeof(u8) * 2 + sizeof(u32));
+    }
+
+    return memory_size;
+}
+
+// Streamable textures past the first TEXTURE_STREAMING_MAX_TEXTURES are loaded whole (see TextureStreamer::add):
+u32 getTotalMemoryForStreamedTextures(String *texture_files, u32 texture_count) {
+    u32 memory_size{0};
+    u32 streamed_count{0};
+    for (u32 i = 0; i < texture_count; i++) {
+        Texture texture;
+        loadHeader(texture, texture_files[i].char_ptr);
+        if (isStreamable(texture) && streamed_count < TEXTURE_STREAMING_MAX_TEXTURES) {
+            memory_size += getStreamedSizeInBytes(texture);
+            streamed_count++;
+        } else
+            memory_size += getSizeInBytes(texture);
+    }
+    return memory_size;
+}
+
+struct StreamedTexture {
+    Texture *texture;
+    void *file;
+    u64 content_positions[TEXTURE_STREAMING_MAX_MIPS]; // Where each mip's content starts in the file
+    u32 content_sizes[TEXTURE_STREAMING_MAX_MIPS];
+    u32 page_counts[TEXTURE_STREAMING_MAX_MIPS];
+    u32 *page_stamps[TEXTURE_STREAMING_MAX_MIPS]; // The last frame each page was used in
+
+    u32 pageSize(u8 mip_index, u32 page) const {
+        return Min(content_sizes[mip_index] - page * (u32)TEXTURE_PAGE_SIZE, (u32)TEXTURE_PAGE_SIZE);
+    }
+};
+
+struct TexturePageLoad {
+    u16 texture_index;
+    u8 mip_index;
+    u32 page;
+};
+
+// Call update() once per frame, while nothing samples the streamed textures: It queues the missing pages that
+// were needed during the frame for the loading thread, and makes room for them within the budget by evicting
+// resident pages that were not used during the frame (in clock order, so the least recently used go first):
+struct TextureStreamer {
+    StreamedTexture textures[TEXTURE_STREAMING_MAX_TEXTURES];
+    u32 texture_count = 0;
+    u64 total_page_count = 0;
+
+    u64 budget;
+    std::atomic<u64> resident_size{0}; // Of pages that are resident or loading
+    u32 frame = 1;
+
+    u32 clock_texture = 0;
+    u8  clock_mip = 0;
+    u32 clock_page = 0;
+
+    TexturePageLoad queue[TEXTURE_STREAMING_QUEUE_SIZE];
+    u32 queue_start = 0;
+    u32 queue_end = 0;
+    bool quit = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread loader;
+
+    explicit TextureStreamer(u64 budget) : budget{budget} {
+        loader = std::thread([this]() { loadPages(); });
+    }
+
+    ~TextureStreamer() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            quit = true;
+        }
+        wake.notify_one();
+        loader.join();
+
+        for (u32 t = 0; t < texture_count; t++) {
+            StreamedTexture &streamed = textures[t];
+            os::closeFile(streamed.file);
+            for (u8 m = 0; m < streamed.texture->mip_count - 1; m++)
+                os::freeMemory(streamed.texture->mips[m].content());
+        }
+    }
+
+    // Loads the texture's header and last mip, reserving (but not loading) the content of its other mips.
+    // Textures that can not be streamed are loaded whole:
+    bool add(Texture &texture, char *file_path, memory::MonotonicAllocator *memory_allocator) {
+        void *file = os::openFileForReading(file_path);
+        if (!file) return false;
+
+        new(&texture) Texture{};
+        TextureFileLayout layout;
+        if (!readLayout(texture, file, layout)) {
+            os::closeFile(file);
+            return false;
+        }
+        if (!isStreamable(texture) || texture_count == TEXTURE_STREAMING_MAX_TEXTURES) {
+            bool loaded = allocateMemory(texture, memory_allocator) && readContent(texture, file, layout);
+            os::closeFile(file);
+            return loaded;
+        }
+#ifndef SLIM_TEXEL_QUADS
+        if (getStreamedSizeInBytes(texture) > (memory_allocator->capacity - memory_allocator->occupied)) {
+            os::closeFile(file);
+            return false;
+        }
+
+        StreamedTexture &streamed = textures[texture_count];
+        streamed.texture = &texture;
+        streamed.file = file;
+
+        texture.mips = (TextureMip*)memory_allocator->allocate(sizeof(TextureMip) * texture.mip_count);
+        TextureMip *mip = texture.mips;
+        for (u8 i = 0; i < texture.mip_count; i++, mip++) {
+            mip->width  = layout.mips[i].width;
+            mip->height = layout.mips[i].height;
+            mip->tiled = texture.flags.tile;
+            mip->page_states = nullptr;
+            mip->used_pages = nullptr;
+            const u32 content_size = TextureMip::GetSizeInBytes(mip->width, mip->height, mip->tiled);
+            streamed.content_positions[i] = layout.content_positions[i];
+            streamed.content_sizes[i] = content_size;
+
+            if (i == texture.mip_count - 1) {
+                mip->setContent(memory_allocator->allocate(content_size));
+                os::setFilePosition(file, layout.content_positions[i]);
+                os::readFromFile(mip->content(), content_size, file);
+                continue;
+            }
+
+            const u32 page_count = getPageCount(content_size);
+            streamed.page_counts[i] = page_count;
+            streamed.page_stamps[i] = (u32*)memory_allocator->allocate(sizeof(u32) * page_count);
+            mip->page_states = (std::atomic<u8>*)memory_allocator->allocate(sizeof(std::atomic<u8>) * page_count);
+            mip->used_pages  = (u8*)memory_allocator->allocate(sizeof(u8) * page_count);
+            for (u32 p = 0; p < page_count; p++) {
+                streamed.page_stamps[i][p] = 0;
+                new(mip->page_states + p) std::atomic<u8>{TexturePageState_Absent};
+                mip->used_pages[p] = 0;
+            }
+            mip->setContent(os::reserveMemory(content_size));
+            total_page_count += page_count;
+        }
+        texture_count++;
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void update() {
+#ifndef SLIM_TEXEL_QUADS
+        frame++;
+        bool requested = false;
+        for (u32 t = 0; t < texture_count; t++) {
+            StreamedTexture &streamed = textures[t];
+            for (u8 m = 0; m < streamed.texture->mip_count - 1; m++) {
+                TextureMip &mip = streamed.texture->mips[m];
+                for (u32 p = 0; p < streamed.page_counts[m]; p++) {
+                    if (!mip.used_pages[p]) continue;
+
+                    mip.used_pages[p] = 0;
+                    streamed.page_stamps[m][p] = frame;
+                    if (mip.page_states[p].load(std::memory_order_acquire) == TexturePageState_Absent && request((u16)t, m, p))
+                        requested = true;
+                }
+            }
+        }
+        if (requested) wake.notify_one();
+#endif
+    }
+
+private:
+#ifndef SLIM_TEXEL_QUADS
+    // Holds the lock throughout, as the loader thread advances queue_start under it:
+    bool request(u16 texture_index, u8 mip_index, u32 page) {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (queue_end - queue_start == TEXTURE_STREAMING_QUEUE_SIZE) return false;
+
+        const u32 size = textures[texture_index].pageSize(mip_index, page);
+        while (resident_size + size > budget)
+            if (!evict()) return false;
+
+        textures[texture_index].texture->mips[mip_index].page_states[page].store(TexturePageState_Loading, std::memory_order_relaxed);
+        resident_size += size;
+        queue[queue_end++ % TEXTURE_STREAMING_QUEUE_SIZE] = {texture_index, mip_index, page};
+        return true;
+    }
+
+    bool evict() {
+        for (u64 step = 0; step < total_page_count; step++) {
+            if (++clock_page >= textures[clock_texture].page_counts[clock_mip]) {
+                clock_page = 0;
+                if (++clock_mip >= textures[clock_texture].texture->mip_count - 1) {
+                    clock_mip = 0;
+                    clock_texture = (clock_texture + 1) % texture_count;
+                }
+            }
+
+            StreamedTexture &streamed = textures[clock_texture];
+            TextureMip &mip = streamed.texture->mips[clock_mip];
+            if (mip.page_states[clock_page].load(std::memory_order_acquire) != TexturePageState_Resident ||
+                streamed.page_stamps[clock_mip][clock_page] == frame)
+                continue;
+
+            const u32 size = streamed.pageSize(clock_mip, clock_page);
+            os::decommitMemory((u8*)mip.content() + (u64)clock_page * TEXTURE_PAGE_SIZE, size);
+            mip.page_states[clock_page].store(TexturePageState_Absent, std::memory_order_relaxed);
+            resident_size -= size;
+            return true;
+        }
+
+        return false;
+    }
+
+    void loadPages() {
+        TexturePageLoad load;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                wake.wait(lock, [this]() { return quit || queue_start != queue_end; });
+                if (quit) return;
+                load = queue[queue_start++ % TEXTURE_STREAMING_QUEUE_SIZE];
+            }
+
+            StreamedTexture &streamed = textures[load.texture_index];
+            TextureMip &mip = streamed.texture->mips[load.mip_index];
+            const u64 offset = (u64)load.page * TEXTURE_PAGE_SIZE;
+            const u32 size = streamed.pageSize(load.mip_index, load.page);
+            u8 *page_content = (u8*)mip.content() + offset;
+            if (os::commitMemory(page_content, size) &&
+                os::setFilePosition(streamed.file, streamed.content_positions[load.mip_index] + offset) &&
+                os::readFromFile(page_content, size, streamed.file)) {
+                mip.page_states[load.page].store(TexturePageState_Resident, std::memory_order_release);
+            } else {
+                os::decommitMemory(page_content, size);
+                resident_size -= size;
+                mip.page_states[load.page].store(TexturePageState_Failed, std::memory_order_relaxed);
+            }
+        }
+    }
+#else
+    void loadPages() {}
+#endif
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "./viewport.h"
+#include "../core/transform.h"
+
+// Vertex positions transformed into view-space and projected onto the screen, held as separate arrays
+// so they can be processed 4 at a time. Outcodes hold the BoxSide_* frustum planes a vertex is outside of
+// (BoxSide_Back for the near plane and BoxSide_Front for the far one, like Frustum::checkEdge).
+// Screen positions are only meaningful for vertices with no outcode.
+struct ViewSpaceVertices {
+    f32 *x{nullptr};
+    f32 *y{nullptr};
+    f32 *z{nullptr};
+    f32 *screen_x{nullptr};
+    f32 *screen_y{nullptr};
+    u8 *outcodes{nullptr};
+    u32 count{0};
+    u32 capacity{0};
+
+    static u64 getSizeInBytes(u32 vertex_count) {
+        u64 padded_count = (vertex_count + 3) & ~3;
+        return padded_count * (sizeof(f32) * 5 + sizeof(u8));
+    }
+
+    void setMemory(u8 *memory, u32 vertex_count) {
+        u32 padded_count = (vertex_count + 3) & ~3;
+        x        = (f32*)memory;
+        y        = x + padded_count;
+        z        = y + padded_count;
+        screen_x = z + padded_count;
+        screen_y = screen_x + padded_count;
+        outcodes = (u8*)(screen_y + padded_count);
+        capacity = vertex_count;
+        count = 0;
+    }
+
+    // Grows (never shrinks) memory of its own, for when these are used as scratch space:
+    bool reserve(u32 vertex_count) {
+        if (vertex_count <= capacity) return true;
+        if (x) os::freeMemory(x);
+
+        u8 *memory = (u8*)os::getMemory(getSizeInBytes(vertex_count));
+        if (!memory) {
+            x = nullptr;
+            capacity = count = 0;
+            return false;
+        }
+        setMemory(memory, vertex_count);
+        return true;
+    }
+
+    INLINE vec3 position(u32 i) const { return {x[i], y[i], z[i]}; }
+    INLINE vec3 screenPosition(u32 i) const { return {screen_x[i], screen_y[i], z[i]}; }
+};
+
+// The combined local-to-view-space transform (camera.internPos(transform.externPos(p))) as a matrix and offset:
+INLINE void getLocalToViewSpace(const Transform &transform, const Camera &camera, mat3 &matrix, vec3 &offset) {
+    offset = camera.internPos(transform.externPos(vec3{0.0f}));
+    matrix.X = camera.internPos(transform.externPos(vec3{1.0f, 0.0f, 0.0f})) - offset;
+    matrix.Y = camera.internPos(transform.externPos(vec3{0.0f, 1.0f, 0.0f})) - offset;
+    matrix.Z = camera.internPos(transform.externPos(vec3{0.0f, 0.0f, 1.0f})) - offset;
+}
+
+// Transforms all positions into view-space, classifies them against the frustum and projects the ones inside it.
+void transformToViewSpace(const vec3 *positions, u32 count, const Transform &transform, const Viewport &viewport,
+                          ViewSpaceVertices &vertices) {
+    mat3 M;
+    vec3 T;
+    getLocalToViewSpace(transform, *viewport.camera, M, T);
+
+    const Frustum &frustum = viewport.frustum;
+    const Dimensions &dimensions = viewport.dimensions;
+    const f32 focal_length = viewport.camera->focal_length;
+    const f32 aspect_ratio = dimensions.width_over_height;
+    const f32 near_distance = frustum.near_clipping_plane_distance;
+    const f32 far_distance = frustum.far_clipping_plane_distance;
+    const vec3 &scale = frustum.projection.scale;
+    vertices.count = count;
+
+#ifdef SLIM_SIMD
+    const __m128 Mxx = _mm_set1_ps(M.X.x), Mxy = _mm_set1_ps(M.X.y), Mxz = _mm_set1_ps(M.X.z);
+    const __m128 Myx = _mm_set1_ps(M.Y.x), Myy = _mm_set1_ps(M.Y.y), Myz = _mm_set1_ps(M.Y.z);
+    const __m128 Mzx = _mm_set1_ps(M.Z.x), Mzy = _mm_set1_ps(M.Z.y), Mzz = _mm_set1_ps(M.Z.z);
+    const __m128 Tx = _mm_set1_ps(T.x), Ty = _mm_set1_ps(T.y), Tz = _mm_set1_ps(T.z);
+    const __m128 near_z = _mm_set1_ps(near_distance);
+    const __m128 far_z = _mm_set1_ps(far_distance);
+    const __m128 fl = _mm_set1_ps(focal_length);
+    const __m128 ar = _mm_set1_ps(aspect_ratio);
+    const __m128 scale_x = _mm_set1_ps(scale.x);
+    const __m128 scale_y = _mm_set1_ps(scale.y);
+    const __m128 h_width = _mm_set1_ps(dimensions.h_width);
+    const __m128 h_height = _mm_set1_ps(dimensions.h_height);
+    const __m128 f_height = _mm_set1_ps(dimensions.f_height);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i back_bit   = _mm_set1_epi32(BoxSide_Back);
+    const __m128i front_bit  = _mm_set1_epi32(BoxSide_Front);
+    const __m128i left_bit   = _mm_set1_epi32(BoxSide_Left);
+    const __m128i right_bit  = _mm_set1_epi32(BoxSide_Right);
+    const __m128i bottom_bit = _mm_set1_epi32(BoxSide_Bottom);
+    const __m128i top_bit    = _mm_set1_epi32(BoxSide_Top);
+
+    u32 last = count ? count - 1 : 0;
+    for (u32 i = 0; i < count; i += 4) {
+        const vec3 &p0 = positions[i];
+        const vec3 &p1 = positions[Min(i + 1, last)];
+        const vec3 &p2 = positions[Min(i + 2, last)];
+        const vec3 &p3 = positions[Min(i + 3, last)];
+        __m128 px = _mm_setr_ps(p0.x, p1.x, p2.x, p3.x);
+        __m128 py = _mm_setr_ps(p0.y, p1.y, p2.y, p3.y);
+        __m128 pz = _mm_setr_ps(p0.z, p1.z, p2.z, p3.z);
+
+        __m128 vx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Mxx, px), _mm_mul_ps(Myx, py)), _mm_add_ps(_mm_mul_ps(Mzx, pz), Tx));
+        __m128 vy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Mxy, px), _mm_mul_ps(Myy, py)), _mm_add_ps(_mm_mul_ps(Mzy, pz), Ty));
+        __m128 vz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Mxz, px), _mm_mul_ps(Myz, py)), _mm_add_ps(_mm_mul_ps(Mzz, pz), Tz));
+        _mm_storeu_ps(vertices.x + i, vx);
+        _mm_storeu_ps(vertices.y + i, vy);
+        _mm_storeu_ps(vertices.z + i, vz);
+
+        __m128 fx = _mm_mul_ps(fl, vx);
+        __m128 fy = _mm_mul_ps(fl, vy);
+        __m128 az = _mm_mul_ps(ar, vz);
+        __m128i codes = _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(vz, near_z)), back_bit);
+        codes = _mm_or_si128(codes, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(vz, far_z)), front_bit));
+        codes = _mm_or_si128(codes, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_add_ps(az, fx), zero)), left_bit));
+        codes = _mm_or_si128(codes, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_sub_ps(az, fx), zero)), right_bit));
+        codes = _mm_or_si128(codes, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_add_ps(vz, fy), zero)), bottom_bit));
+        codes = _mm_or_si128(codes, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_sub_ps(vz, fy), zero)), top_bit));
+        codes = _mm_packus_epi16(_mm_packs_epi32(codes, codes), codes);
+        *(int*)(vertices.outcodes + i) = _mm_cvtsi128_si32(codes);
+
+        // Vertices behind the camera get garbage here, but those are flagged as outside the near plane:
+        __m128 one_over_z = _mm_div_ps(one, vz);
+        _mm_storeu_ps(vertices.screen_x + i, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(scale_x, vx), one_over_z), one), h_width));
+        _mm_storeu_ps(vertices.screen_y + i, _mm_sub_ps(f_height, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(scale_y, vy), one_over_z), one), h_height)));
+    }
+#else
+    vec3 v;
+    for (u32 i = 0; i < count; i++) {
+        v = M * positions[i] + T;
+        vertices.x[i] = v.x;
+        vertices.y[i] = v.y;
+        vertices.z[i] = v.z;
+
+        u8 code = 0;
+        if (v.z < near_distance) code |= BoxSide_Back;
+        if (v.z > far_distance) code |= BoxSide_Front;
+        if (aspect_ratio * v.z + focal_length * v.x < 0) code |= BoxSide_Left;
+        if (aspect_ratio * v.z - focal_length * v.x < 0) code |= BoxSide_Right;
+        if (v.z + focal_length * v.y < 0) code |= BoxSide_Bottom;
+        if (v.z - focal_length * v.y < 0) code |= BoxSide_Top;
+        vertices.outcodes[i] = code;
+
+        if (!code) {
+            frustum.projectPoint(v, dimensions);
+            vertices.screen_x[i] = v.x;
+            vertices.screen_y[i] = v.y;
+        }
+    }
+#endif
+}
+
+#ifndef VIEW_SPACE_CACHE_CAPACITY
+#define VIEW_SPACE_CACHE_CAPACITY 64
+#endif
+
+#ifndef VIEW_SPACE_CACHE_MEMORY_SIZE
+#define VIEW_SPACE_CACHE_MEMORY_SIZE Megabytes(64)
+#endif
+
+// Everything the view-space vertices of a source were computed from. The transform and camera are
+// captured by their combined matrix and the projection parameters rather than by version counters,
+// so any change to either is picked up no matter where it was made. Changes to the source's own
+// positions are not tracked: callers bump source_version (or call invalidate()) for those.
+struct ViewSpaceKey {
+    const void *source{nullptr};
+    u64 source_version{0};
+    u32 vertex_count{0};
+    mat3 matrix;
+    vec3 offset;
+    f32 focal_length, aspect_ratio, near_distance, far_distance;
+    f32 scale_x, scale_y, h_width, h_height;
+
+    ViewSpaceKey() = default;
+    ViewSpaceKey(const void *source, u64 source_version, u32 vertex_count, const Transform &transform, const Viewport &viewport) :
+        source{source}, source_version{source_version}, vertex_count{vertex_count},
+        focal_length{viewport.camera->focal_length},
+        aspect_ratio{viewport.dimensions.width_over_height},
+        near_distance{viewport.frustum.near_clipping_plane_distance},
+        far_distance{viewport.frustum.far_clipping_plane_distance},
+        scale_x{viewport.frustum.projection.scale.x},
+        scale_y{viewport.frustum.projection.scale.y},
+        h_width{viewport.dimensions.h_width},
+        h_height{viewport.dimensions.h_height} {
+        getLocalToViewSpace(transform, *viewport.camera, matrix, offset);
+    }
+
+    bool operator == (const ViewSpaceKey &other) const {
+        return source == other.source && source_version == other.source_version && vertex_count == other.vertex_count &&
+               matrix.X == other.matrix.X && matrix.Y == other.matrix.Y && matrix.Z == other.matrix.Z && offset == other.offset &&
+               focal_length == other.focal_length && aspect_ratio == other.aspect_ratio &&
+               near_distance == other.near_distance && far_distance == other.far_distance &&
+               scale_x == other.scale_x && scale_y == other.scale_y && h_width == other.h_width && h_height == other.h_height;
+    }
+};
+
+// Keeps the view-space vertices (with their outcodes and screen positions) of drawn sources across frames,
+// and only recomputes them when their key changes. All entries live in a single arena: when the entry table
+// is full the least recently used entry is evicted (its memory is reused when large enough, and reclaimed
+// otherwise on the next reset), and only once the arena itself runs out does everything start over.
+struct ViewSpaceCache {
+    struct Entry {
+        ViewSpaceKey key;
+        ViewSpaceVertices vertices;
+        u64 last_used{0};
+        bool is_filled{false};
+    };
+
+    memory::MonotonicAllocator arena;
+    Entry entries[VIEW_SPACE_CACHE_CAPACITY];
+    u32 entry_count{0};
+    u64 use_count{0};
+
+    void reset() {
+        arena.reset();
+        entry_count = 0;
+    }
+
+    void invalidate(const void *source) {
+        for (u32 i = 0; i < entry_count; i++)
+            if (entries[i].key.source == source)
+                entries[i].is_filled = false;
+    }
+
+    // Returns the vertices stored for the given source, setting is_current when they were computed with
+    // the same key. Otherwise the caller is expected to fill them in and then commit() them, as until then
+    // they are never considered current. Returns nullptr when they don't fit.
+    ViewSpaceVertices* get(const void *source, u64 source_version, u32 vertex_count,
+                           const Transform &transform, const Viewport &viewport, bool &is_current) {
+        ViewSpaceKey key{source, source_version, vertex_count, transform, viewport};
+        is_current = false;
+        use_count++;
+
+        Entry *entry = nullptr;
+        for (u32 i = 0; i < entry_count; i++)
+            if (entries[i].key.source == source) {
+                entry = &entries[i];
+                break;
+            }
+
+        if (entry) {
+            is_current = entry->is_filled && entry->key == key;
+            if (entry->vertices.capacity < vertex_count) {
+                *entry = entries[--entry_count]; // Outgrown; its memory is reclaimed on the next reset
+                entry = nullptr;
+            }
+        }
+
+        if (!entry) {
+            u64 size = ViewSpaceVertices::getSizeInBytes(vertex_count);
+            if (!arena.address) arena = memory::MonotonicAllocator{VIEW_SPACE_CACHE_MEMORY_SIZE};
+            if (size > arena.capacity) return nullptr;
+
+            bool fits_in_arena = size <= arena.capacity - arena.occupied;
+            bool needs_memory = true;
+            if (entry_count < VIEW_SPACE_CACHE_CAPACITY && fits_in_arena) entry = &entries[entry_count++];
+            else {
+                // Take over the least recently used entry (one whose memory is large enough, when the arena is out of room):
+                for (u32 i = 0; i < entry_count; i++) {
+                    Entry &candidate = entries[i];
+                    if (candidate.vertices.capacity < vertex_count && !fits_in_arena) continue;
+                    if (!entry || candidate.last_used < entry->last_used) entry = &candidate;
+                }
+                if (entry) needs_memory = entry->vertices.capacity < vertex_count;
+                else {
+                    reset();
+                    entry = &entries[entry_count++];
+                }
+            }
+            if (needs_memory) entry->vertices.setMemory((u8*)arena.allocate(size), vertex_count);
+        }
+
+        entry->last_used = use_count;
+        if (!is_current) {
+            entry->key = key;
+            entry->is_filled = false;
+        }
+        return &entry->vertices;
+    }
+
+    // Marks vertices returned by get() as filled in for the key they were requested with:
+    void commit(const ViewSpaceVertices *vertices) {
+        for (u32 i = 0; i < entry_count; i++)
+            if (&entries[i].vertices == vertices) {
+                entries[i].is_filled = true;
+                return;
+            }
+    }
+
+    const ViewSpaceVertices* get(const vec3 *positions, u32 vertex_count, const Transform &transform, const Viewport &viewport,
+                                 u64 source_version = 0) {
+        bool is_current;
+        ViewSpaceVertices *vertices = get(positions, source_version, vertex_count, transform, viewport, is_current);
+        if (vertices && !is_current) {
+            transformToViewSpace(positions, vertex_count, transform, viewport, *vertices);
+            commit(vertices);
+        }
+        return vertices;
+    }
+};
+
+ViewSpaceCache view_space_cache;
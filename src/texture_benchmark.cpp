@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <chrono>
+
+#include "./slim/platforms/win32_base.h"
+#include "./slim/core/texture.h"
+
+// Compares bilinear sampling from a mip in the linear layout against the same mip in the 4x4-block tiled
+// layout (see TextureMip::texelOffset), over random, row-coherent and column-coherent streams of uvs:
+#define BENCHMARK_MIP_SIZE 2048
+#define BENCHMARK_SAMPLE_COUNT (1024 * 1024)
+#define BENCHMARK_RUN_COUNT 5
+
+enum UVStream {
+    UVStream_Random,
+    UVStream_Rows,
+    UVStream_Columns,
+
+    UVStream_Count
+};
+
+INLINE u32 nextRandom(u32 &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void initMip(TextureMip &mip, bool tiled) {
+    mip.width = mip.height = BENCHMARK_MIP_SIZE;
+    mip.tiled = tiled;
+    mip.texels = new Texel[TextureMip::GetSizeInBytes(mip.width, mip.height, tiled) / sizeof(Texel)]();
+
+    // Same texels in both layouts (including the apron):
+    u32 state = 1;
+    for (u32 y = 0; y < mip.height + 2; y++)
+        for (u32 x = 0; x < mip.width + 2; x++) {
+            u32 random = nextRandom(state);
+            Texel &texel = mip.texels[mip.texelOffset(x, y)];
+            texel.R = (u8)random;
+            texel.G = (u8)(random >> 8);
+            texel.B = (u8)(random >> 16);
+            texel.A = 255;
+        }
+}
+
+void initUVs(UVStream stream, f32 *u, f32 *v) {
+    const f32 texel_size = 1.0f / (f32)BENCHMARK_MIP_SIZE;
+    u32 state = 7;
+    for (u32 i = 0; i < BENCHMARK_SAMPLE_COUNT; i++) {
+        const f32 along  = (f32)(i % BENCHMARK_MIP_SIZE) * texel_size;
+        const f32 across = (f32)(i / BENCHMARK_MIP_SIZE) * texel_size * 4;
+        switch (stream) {
+            case UVStream_Random:
+                u[i] = (f32)(nextRandom(state) & 0xFFFFFF) / (f32)0x1000000;
+                v[i] = (f32)(nextRandom(state) & 0xFFFFFF) / (f32)0x1000000;
+                break;
+            case UVStream_Rows:    u[i] = along;  v[i] = across; break;
+            default:               u[i] = across; v[i] = along;  break;
+        }
+    }
+}
+
+// Best of BENCHMARK_RUN_COUNT runs, in milliseconds:
+f64 timeSampling(const TextureMip &mip, const f32 *u, const f32 *v, f32 &sum) {
+    f64 best = INFINITY;
+    for (u32 run = 0; run < BENCHMARK_RUN_COUNT; run++) {
+        auto start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < BENCHMARK_SAMPLE_COUNT; i++) sum += mip.sample(u[i], v[i]).color.r;
+        f64 milliseconds = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = Min(best, milliseconds);
+    }
+    return best;
+}
+
+int main() {
+#ifdef SLIM_TEXEL_QUADS
+    printf("The tiled layout is not available with SLIM_TEXEL_QUADS\n");
+    return 1;
+#else
+    TextureMip linear_mip, tiled_mip;
+    initMip(linear_mip, false);
+    initMip(tiled_mip, true);
+
+    f32 *u = new f32[BENCHMARK_SAMPLE_COUNT];
+    f32 *v = new f32[BENCHMARK_SAMPLE_COUNT];
+    const char *stream_names[UVStream_Count] = {"random uv", "row-coherent uv", "column-coherent uv"};
+    f32 sum = 0;
+    printf("%u bilinear samples from a %u^2 mip, best of %u:\n", BENCHMARK_SAMPLE_COUNT, BENCHMARK_MIP_SIZE, BENCHMARK_RUN_COUNT);
+    for (u32 stream = 0; stream < UVStream_Count; stream++) {
+        initUVs((UVStream)stream, u, v);
+        f64 linear_ms = timeSampling(linear_mip, u, v, sum);
+        f64 tiled_ms  = timeSampling(tiled_mip,  u, v, sum);
+        printf("  %-20s linear %7.2f ms, tiled %7.2f ms\n", stream_names[stream], linear_ms, tiled_ms);
+    }
+    printf("(checksum %f)\n", sum);
+
+    delete[] u;
+    delete[] v;
+    delete[] linear_mip.texels;
+    delete[] tiled_mip.texels;
+    return 0;
+#endif
+}